@@ -22,6 +22,7 @@
 
 #include <inttypes.h>
 #include <stdio.h> // for size_t
+#include <stdarg.h>
 
 #include "WString.h"
 #include "Printable.h"
@@ -31,6 +32,15 @@
 #define OCT 8
 #define BIN 2
 
+// Lets GCC check the arguments of printf() against the format string
+#ifdef __GNUC__
+#define PRINT_FORMAT_CHECK(f, a) __attribute__((format(printf, f, a)))
+#else
+#define PRINT_FORMAT_CHECK(f, a)
+#endif
+
+#define PRINTF_BUFFER_SIZE 32   // characters per write() of printf()
+
 typedef unsigned char uint8_t;
 
 class Print
@@ -82,6 +92,9 @@ class Print
     size_t println(double, int = 2);
     size_t println(const Printable&);
     size_t println(void);
+
+    size_t printf(const char *format, ...) PRINT_FORMAT_CHECK(2, 3);
+    size_t vprintf(const char *format, va_list args);
 };
 
 #endif
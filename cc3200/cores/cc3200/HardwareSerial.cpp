@@ -46,6 +46,8 @@
 #include "driverlib/prcm.h"
 #include "driverlib/uart.h"
 #include "driverlib/systick.h"
+#include "driverlib/udma.h"
+#include "udma_if.h"
 #include "HardwareSerial.h"
 
 #define TX_BUFFER_EMPTY    (txReadIndex == txWriteIndex)
@@ -55,6 +57,8 @@
 #define RX_BUFFER_FULL     (((rxWriteIndex + 1) % rxBufferSize) == rxReadIndex)
 
 #define UART_BASE g_ulUARTBase[uartModule]
+#define UART_DMA_RX_CHANNEL g_ulUARTDMA[uartModule][0]
+#define UART_DMA_TX_CHANNEL g_ulUARTDMA[uartModule][1]
 
 static const unsigned long g_ulUARTBase[2] =
 {
@@ -101,6 +105,16 @@ static const unsigned long g_ulUARTConfig[2][2] =
 	{PIN_57, PIN_55}, {PIN_02, PIN_01}
 };
 
+//*****************************************************************************
+//
+// The list of uDMA RX and TX channels.
+//
+//*****************************************************************************
+static const unsigned long g_ulUARTDMA[2][2] =
+{
+	{UDMA_CH8_UARTA0_RX, UDMA_CH9_UARTA0_TX}, {UDMA_CH10_UARTA1_RX, UDMA_CH11_UARTA1_TX}
+};
+
 void (*g_UARTIntHandlers[2])(void) =
 {
 	UARTIntHandler, UARTIntHandler1
@@ -119,6 +133,10 @@ HardwareSerial::HardwareSerial(void)
 //	rxBuffer = (unsigned char *) 0xFFFFFFFF;
 	txBufferSize = SERIAL_BUFFER_SIZE;
 	rxBufferSize = SERIAL_BUFFER_SIZE;
+	baudRate = 0;
+	dmaMode = false;
+	txDMACount = 0;
+	rxDropped = 0;
 }
 
 HardwareSerial::HardwareSerial(unsigned long module) 
@@ -133,6 +151,10 @@ HardwareSerial::HardwareSerial(unsigned long module)
 	//rxBuffer = (unsigned char *) 0xFFFFFFFF;
 	txBufferSize = SERIAL_BUFFER_SIZE;
 	rxBufferSize = SERIAL_BUFFER_SIZE;
+	baudRate = 0;
+	dmaMode = false;
+	txDMACount = 0;
+	rxDropped = 0;
 }
 
 // Private Methods //////////////////////////////////////////////////////////////
@@ -153,6 +175,28 @@ HardwareSerial::flushAll(void)
 void
 HardwareSerial::primeTransmit(unsigned long ulBase)
 {
+	if (dmaMode) {
+		unsigned long ulInt = MAP_IntMasterDisable();
+
+		/* Release the characters of the last transfer once it is done,
+		 * then send the next contiguous run of the transmit buffer. */
+		if (txDMACount && !MAP_uDMAChannelIsEnabled(UART_DMA_TX_CHANNEL)) {
+			txReadIndex = (txReadIndex + txDMACount) % txBufferSize;
+			txDMACount = 0;
+		}
+		if (!txDMACount && !TX_BUFFER_EMPTY) {
+			txDMACount = ((txWriteIndex > txReadIndex) ? txWriteIndex : txBufferSize) - txReadIndex;
+			MAP_uDMAChannelTransferSet(UART_DMA_TX_CHANNEL | UDMA_PRI_SELECT,
+					UDMA_MODE_BASIC, txBuffer + txReadIndex,
+					(void *)(ulBase + UART_O_DR), txDMACount);
+			MAP_uDMAChannelEnable(UART_DMA_TX_CHANNEL);
+		}
+		if (!ulInt) {
+			MAP_IntMasterEnable();
+		}
+		return;
+	}
+
 	/* Do we have any data to transmit? */
 	if(!TX_BUFFER_EMPTY) {
 		/* Yes - take some characters out of the transmit buffer and feed
@@ -204,10 +248,147 @@ void HardwareSerial::begin(unsigned long baud)
 	MAP_UARTEnable(UART_BASE);
 
 	MAP_UARTIntEnable(UART_BASE, UART_INT_RX | UART_INT_RT | UART_INT_TX);
+
+	if (dmaMode)
+		startDMA();
+}
+
+/* Selects the uDMA mode, before or after begin(). The receive buffer is
+ * then filled by a ping-pong transfer and the transmit buffer is sent by
+ * uDMA transfers: the UART interrupt only runs when a transfer completes,
+ * or when the line goes idle while characters are left in the RX FIFO.
+ * The characters that are not read within one receive buffer are
+ * overwritten. */
+void HardwareSerial::setDMA(bool enable)
+{
+	if (enable == dmaMode)
+		return;
+	if (!baudRate) {
+		/* not started yet: begin() starts the uDMA */
+		dmaMode = enable;
+		return;
+	}
+	flush();
+	if (enable)
+		startDMA();
+	else
+		stopDMA();
+}
+
+/* Arms the primary or alternate transfer of the receive ping-pong, each
+ * one fills half of the receive buffer. */
+void HardwareSerial::rxDMAArm(unsigned long select)
+{
+	unsigned long half = rxBufferSize / 2;
+
+	MAP_uDMAChannelTransferSet(UART_DMA_RX_CHANNEL | select, UDMA_MODE_PINGPONG,
+			(void *)(UART_BASE + UART_O_DR),
+			rxBuffer + ((select == UDMA_ALT_SELECT) ? half : 0), half);
+}
+
+/* Updates the write index of the receive buffer from the progress of the
+ * transfer that is running. */
+void HardwareSerial::rxDMASync(void)
+{
+	unsigned long ulInt = MAP_IntMasterDisable();
+	unsigned long half = rxBufferSize / 2;
+	unsigned long select =
+		(MAP_uDMAChannelAttributeGet(UART_DMA_RX_CHANNEL) & UDMA_ATTR_ALTSELECT) ?
+		UDMA_ALT_SELECT : UDMA_PRI_SELECT;
+	unsigned long index = ((select == UDMA_ALT_SELECT) ? half : 0) + half -
+		MAP_uDMAChannelSizeGet(UART_DMA_RX_CHANNEL | select);
+
+	unsigned long used = (rxWriteIndex + rxBufferSize - rxReadIndex) % rxBufferSize +
+		(index + rxBufferSize - rxWriteIndex) % rxBufferSize;
+
+	/* The transfer overwrote characters that were not read: drop the
+	 * oldest ones so that the buffer holds the last rxBufferSize - 1. */
+	if (used > rxBufferSize - 1) {
+		rxDropped += used - (rxBufferSize - 1);
+		rxReadIndex = (index + 1) % rxBufferSize;
+	}
+	rxWriteIndex = index % rxBufferSize;
+	if (!ulInt) {
+		MAP_IntMasterEnable();
+	}
+}
+
+/* Returns the characters lost by uDMA receive overruns. */
+unsigned long HardwareSerial::getDropped(void)
+{
+	return rxDropped;
+}
+
+void HardwareSerial::startDMA(void)
+{
+	unsigned long ulInt = MAP_IntMasterDisable();
+
+	/* shared with the WiFi library */
+	UDMAInit();
+	dmaMode = true;
+	txDMACount = 0;
+	rxReadIndex = 0;
+	rxWriteIndex = 0;
+
+	MAP_uDMAChannelAssign(UART_DMA_RX_CHANNEL);
+	MAP_uDMAChannelAssign(UART_DMA_TX_CHANNEL);
+
+	/* RX: bursts of 4 characters when the FIFO is half full. The characters
+	 * left when the line goes idle raise the receive timeout interrupt. */
+	MAP_uDMAChannelAttributeDisable(UART_DMA_RX_CHANNEL, UDMA_ATTR_ALTSELECT |
+			UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK);
+	MAP_uDMAChannelAttributeEnable(UART_DMA_RX_CHANNEL, UDMA_ATTR_USEBURST);
+	MAP_uDMAChannelControlSet(UART_DMA_RX_CHANNEL | UDMA_PRI_SELECT,
+			UDMA_SIZE_8 | UDMA_SRC_INC_NONE | UDMA_DST_INC_8 | UDMA_ARB_4);
+	MAP_uDMAChannelControlSet(UART_DMA_RX_CHANNEL | UDMA_ALT_SELECT,
+			UDMA_SIZE_8 | UDMA_SRC_INC_NONE | UDMA_DST_INC_8 | UDMA_ARB_4);
+	rxDMAArm(UDMA_PRI_SELECT);
+	rxDMAArm(UDMA_ALT_SELECT);
+
+	/* TX: whenever the FIFO is half empty. */
+	MAP_uDMAChannelAttributeDisable(UART_DMA_TX_CHANNEL, UDMA_ATTR_ALTSELECT |
+			UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK | UDMA_ATTR_USEBURST);
+	MAP_uDMAChannelControlSet(UART_DMA_TX_CHANNEL | UDMA_PRI_SELECT,
+			UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+
+	MAP_UARTFIFOLevelSet(UART_BASE, UART_FIFO_TX4_8, UART_FIFO_RX4_8);
+	MAP_UARTIntDisable(UART_BASE, UART_INT_RX | UART_INT_TX);
+	MAP_UARTIntEnable(UART_BASE, UART_INT_RT | UART_INT_DMARX | UART_INT_DMATX);
+	MAP_uDMAChannelEnable(UART_DMA_RX_CHANNEL);
+	MAP_UARTDMAEnable(UART_BASE, UART_DMA_RX | UART_DMA_TX);
+
+	if (!ulInt) {
+		MAP_IntMasterEnable();
+	}
+}
+
+void HardwareSerial::stopDMA(void)
+{
+	unsigned long ulInt = MAP_IntMasterDisable();
+
+	rxDMASync();
+	MAP_UARTDMADisable(UART_BASE, UART_DMA_RX | UART_DMA_TX);
+	MAP_uDMAChannelDisable(UART_DMA_RX_CHANNEL);
+	MAP_uDMAChannelDisable(UART_DMA_TX_CHANNEL);
+	dmaMode = false;
+	txDMACount = 0;
+
+	MAP_UARTIntDisable(UART_BASE, UART_INT_DMARX | UART_INT_DMATX);
+	MAP_UARTIntEnable(UART_BASE, UART_INT_RX | UART_INT_RT);
+
+	if (!ulInt) {
+		MAP_IntMasterEnable();
+	}
 }
 
 void HardwareSerial::setModule(unsigned long module)
 {
+	if (dmaMode && baudRate) {
+		/* begin() starts the uDMA again on the new module */
+		flush();
+		stopDMA();
+		dmaMode = true;
+	}
 	MAP_UARTIntDisable(UART_BASE, UART_INT_RX | UART_INT_RT | UART_INT_TX);
 	MAP_UARTIntUnregister(UART_BASE);
 	uartModule = module;
@@ -226,12 +407,18 @@ void HardwareSerial::end()
 		MAP_IntMasterEnable();
 	}
 
+	if (dmaMode) {
+		stopDMA();
+		dmaMode = true;
+	}
 	MAP_UARTIntDisable(UART_BASE, UART_INT_RX | UART_INT_RT | UART_INT_TX);
 	MAP_UARTIntUnregister(UART_BASE);
 }
 
 int HardwareSerial::available(void)
 {
+	if (dmaMode)
+		rxDMASync();
 	return (rxWriteIndex >= rxReadIndex) ?
 		(rxWriteIndex - rxReadIndex) : rxBufferSize - (rxReadIndex - rxWriteIndex);
 }
@@ -240,6 +427,8 @@ int HardwareSerial::peek(void)
 {
 	unsigned char cChar = 0;
 
+	if (dmaMode)
+		rxDMASync();
 	if(RX_BUFFER_EMPTY) {
 		return -1;
 	}
@@ -261,9 +450,34 @@ int HardwareSerial::read(void)
 	return iChar;
 }
 
+/* Points 'ptr' at the received characters up to the end of the receive
+ * buffer. */
+size_t HardwareSerial::peekSpan(const uint8_t *&ptr)
+{
+	unsigned long writeIndex;
+
+	if (dmaMode)
+		rxDMASync();
+	writeIndex = rxWriteIndex;
+	ptr = rxBuffer + rxReadIndex;
+	return ((writeIndex >= rxReadIndex) ? writeIndex : rxBufferSize) - rxReadIndex;
+}
+
+void HardwareSerial::consume(size_t n)
+{
+	unsigned long used = (rxWriteIndex + rxBufferSize - rxReadIndex) % rxBufferSize;
+
+	if (n > used)
+		n = used;
+	rxReadIndex = (rxReadIndex + n) % rxBufferSize;
+}
+
 void HardwareSerial::flush()
 {
-	while(!TX_BUFFER_EMPTY);
+	while(!TX_BUFFER_EMPTY) {
+		if (dmaMode)
+			primeTransmit(UART_BASE);
+	}
 }
 
 HardwareSerial::operator bool()
@@ -279,7 +493,10 @@ size_t HardwareSerial::write(uint8_t c)
 	ASSERT(c != 0);
 
 	/* Send the character to the UART output. */
-	while (TX_BUFFER_FULL);
+	while (TX_BUFFER_FULL) {
+		if (dmaMode)
+			primeTransmit(UART_BASE);
+	}
 
 	txBuffer[txWriteIndex] = c;
 	txWriteIndex = (txWriteIndex + 1) % txBufferSize;
@@ -305,6 +522,11 @@ void HardwareSerial::UARTIntHandler(void)
 	ulInts = MAP_UARTIntStatus(UART_BASE, true);
 	MAP_UARTIntClear(UART_BASE, ulInts);
 
+	if (dmaMode) {
+		UARTDMAHandler(ulInts);
+		return;
+	}
+
 	/* Are we being interrupted because the TX FIFO has space available? */
 	if(ulInts & UART_INT_TX) {
 		/* Move as many bytes as we can into the transmit FIFO. */
@@ -333,6 +555,30 @@ void HardwareSerial::UARTIntHandler(void)
 	}
 }
 
+/* UART interrupt in uDMA mode: a transfer completed, or the line went idle. */
+void HardwareSerial::UARTDMAHandler(unsigned long ulInts)
+{
+	/* Give the full halves of the receive buffer back to the ping-pong. */
+	if (MAP_uDMAChannelModeGet(UART_DMA_RX_CHANNEL | UDMA_PRI_SELECT) == UDMA_MODE_STOP)
+		rxDMAArm(UDMA_PRI_SELECT);
+	if (MAP_uDMAChannelModeGet(UART_DMA_RX_CHANNEL | UDMA_ALT_SELECT) == UDMA_MODE_STOP)
+		rxDMAArm(UDMA_ALT_SELECT);
+	if (!MAP_uDMAChannelIsEnabled(UART_DMA_RX_CHANNEL))
+		MAP_uDMAChannelEnable(UART_DMA_RX_CHANNEL);
+
+	/* Receive timeout: less than a burst is left in the RX FIFO, let
+	 * single requests move it. */
+	if (ulInts & UART_INT_RT) {
+		MAP_uDMAChannelAttributeDisable(UART_DMA_RX_CHANNEL, UDMA_ATTR_USEBURST);
+		while (MAP_UARTCharsAvail(UART_BASE) &&
+		       MAP_uDMAChannelIsEnabled(UART_DMA_RX_CHANNEL)) {
+		}
+		MAP_uDMAChannelAttributeEnable(UART_DMA_RX_CHANNEL, UDMA_ATTR_USEBURST);
+	}
+
+	primeTransmit(UART_BASE);
+}
+
 void UARTIntHandler(void)
 {
 	Serial.UARTIntHandler();
@@ -51,8 +51,16 @@ class HardwareSerial : public Stream
 		unsigned long rxReadIndex;
 		unsigned long uartModule;
 		unsigned long baudRate;
+		bool dmaMode;
+		unsigned long txDMACount;	/* characters sent by the running TX transfer */
+		unsigned long rxDropped;	/* characters lost by uDMA receive overruns */
 		void flushAll(void);
 		void primeTransmit(unsigned long ulBase);
+		void startDMA(void);
+		void stopDMA(void);
+		void rxDMAArm(unsigned long select);
+		void rxDMASync(void);
+		void UARTDMAHandler(unsigned long ulInts);
 
 	public:
 		HardwareSerial(void);
@@ -61,10 +69,14 @@ class HardwareSerial : public Stream
 		void setBufferSize(unsigned long, unsigned long);
 		void setModule(unsigned long);
 		void setPins(unsigned long);
+		void setDMA(bool);
+		unsigned long getDropped(void);
 		void end(void);
 		virtual int available(void);
 		virtual int peek(void);
 		virtual int read(void);
+		virtual size_t peekSpan(const uint8_t *&ptr);
+		virtual void consume(size_t n);
 		virtual void flush(void);
 		void UARTIntHandler(void);
 		virtual size_t write(uint8_t c);
@@ -50,6 +50,13 @@ class Stream : public Print
     virtual int peek() = 0;
     virtual void flush() = 0;
 
+    // zero-copy access to the received data: points 'ptr' at the largest
+    // contiguous run of bytes that can be read without copying, and returns
+    // its length (0 if there is none, or if the stream has no buffer).
+    // The bytes stay in the stream until consume(n) drops the first n.
+    virtual size_t peekSpan(const uint8_t *&ptr) { ptr = NULL; return 0; }
+    virtual void consume(size_t n) { while (n-- && read() >= 0); }
+
     Stream() {_timeout=1000;}
 
 // parsing methods
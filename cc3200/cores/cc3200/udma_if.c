@@ -77,6 +77,7 @@ tDMAControlTable gpCtlTbl[CTL_TBL_SIZE];
 
 unsigned char iDone;
 tAppCallbackHndl gfpAppCallbackHndl[MAX_NUM_CH];
+static unsigned char bInitialized = 0;
 
 //*****************************************************************************
 //
@@ -126,12 +127,22 @@ DmaErrorIntHandler(void)
 //! This function initializes
 //!        1. Initializes the McASP module
 //!
+//! The control table is shared by all the drivers (WiFi, HardwareSerial):
+//! only the first call initializes it, so the channels already set up keep
+//! running.
+//!
 //! \return None.
 //
 //*****************************************************************************
 void UDMAInit()
 {
     unsigned int uiLoopCnt;
+
+    if(bInitialized)
+    {
+        return;
+    }
+    bInitialized = 1;
     //
     // Enable McASP at the PRCM module
     //
@@ -346,6 +357,7 @@ void UDMADeInit()
     // Disable the uDMA
     //
     MAP_uDMADisable();
+    bInitialized = 0;
 }
 
 void DMASetupTransfer(unsigned long ulChannel, unsigned long ulMode,
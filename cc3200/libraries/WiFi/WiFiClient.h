@@ -47,6 +47,8 @@ public:
     virtual int read();
     virtual int read(uint8_t* buf, size_t size);
     virtual int peek();
+    virtual size_t peekSpan(const uint8_t *&ptr);
+    virtual void consume(size_t n);
     virtual void flush();
     virtual void stop();
     virtual uint8_t connected();
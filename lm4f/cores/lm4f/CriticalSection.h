@@ -0,0 +1,82 @@
+/*
+  CriticalSection.h - interrupt priority aware critical sections.
+
+  A critical section only has to mask the interrupts that touch the data
+  it protects. criticalEnter(level) raises BASEPRI to 'level', the priority
+  of the most urgent of these interrupts: the interrupts with a lower
+  priority value (more urgent) keep running. Level 0 masks all the
+  interrupts with PRIMASK, like IntMasterDisable().
+
+  The TM4C parts implement 3 priority bits: levels are multiples of 0x20.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef CriticalSection_h
+#define CriticalSection_h
+
+#include <stdint.h>
+#include "driverlib/cpu.h"
+#include "driverlib/rom.h"
+
+/* Masks the interrupts of priority 'level' and lower, nested sections
+ * never lower the mask. Returns the previous state for criticalExit(). */
+static inline uint32_t criticalEnter(uint8_t level)
+{
+	uint32_t old;
+
+	if (!level)
+		return ROM_IntMasterDisable();
+	old = CPUbasepriGet();
+	if (!old || old > level)
+		CPUbasepriSet(level);
+	return old;
+}
+
+/* Restores the state returned by criticalEnter(level). */
+static inline void criticalExit(uint8_t level, uint32_t old)
+{
+	if (!level) {
+		if (!old)
+			ROM_IntMasterEnable();
+		return;
+	}
+	CPUbasepriSet(old);
+}
+
+#ifdef __cplusplus
+/*
+ * Masks the interrupts of priority 'level' and lower for the lifetime of
+ * the object:
+ *
+ *   {
+ *       CriticalSection lock(ETHERNET_INT_PRIORITY);
+ *       ...
+ *   }
+ */
+class CriticalSection
+{
+	private:
+		uint8_t _level;
+		uint32_t _old;
+		CriticalSection(const CriticalSection &);
+		CriticalSection &operator=(const CriticalSection &);
+	public:
+		CriticalSection(uint8_t level = 0) : _level(level), _old(criticalEnter(level)) {}
+		~CriticalSection() { criticalExit(_level, _old); }
+};
+#endif
+
+#endif
@@ -28,6 +28,7 @@
 #include "driverlib/gpio.h" 
 #include "driverlib/pin_map.h"
 #include "driverlib/rom.h"
+#include "CriticalSection.h"
 
 #ifdef __cplusplus
 extern "C"{ 
@@ -297,12 +298,56 @@ extern const uint32_t digital_pin_to_analog_in[];
 void delayMicroseconds(unsigned int us);
 unsigned long micros();
 unsigned long millis();
+uint64_t cycles64();
+uint64_t nanos();
 void timerInit();
+void timerSleep(uint32_t ms);
 void registerSysTickCb(void (*userFunc)(uint32_t));
+
+// Implemented in wiring_timer.c
+typedef struct {
+	void (*callback)(uint32_t arg);
+	uint32_t arg;
+	uint32_t expires;		// millis() of the next expiry
+	uint32_t period;		// 0 for a one-shot timer
+	uint32_t slot;			// heap index + 1, 0 when stopped
+} softTimer_t;
+
+void softTimerInit(softTimer_t *timer, void (*callback)(uint32_t), uint32_t arg);
+int softTimerStart(softTimer_t *timer, uint32_t ms, uint32_t period);
+void softTimerStop(softTimer_t *timer);
+int softTimerActive(softTimer_t *timer);
+
+// Implemented in wiring_defer.c
+int deferWork(void (*work)(uint32_t), uint32_t arg);
+void runDeferredWork(void);
+void registerDeferredWorker(void (*wake)(void));
+int hasDeferredWorker(void);
+
+// Implemented in wiring_trace.cpp
+int traceBegin(uint16_t entries);
+void traceStart(void);
+void traceStop(void);
+void traceEvent(uint16_t event, uint16_t arg);
+extern volatile uint8_t traceEnabled;
 #ifdef __cplusplus
 } // extern "C"
 #endif
 
+// Trace events, recorded with TRACE(event, arg)
+#define TRACE_EVENT_SWITCH      1   // task switched in, arg: task id
+#define TRACE_EVENT_READY       2   // task woken, arg: task id
+#define TRACE_EVENT_BLOCK       3   // task out of the ready queue, arg: task id
+#define TRACE_EVENT_ISR_ENTER   4   // arg: exception number (IRQ + 16)
+#define TRACE_EVENT_ISR_EXIT    5   // arg: exception number (IRQ + 16)
+#define TRACE_EVENT_RELEASE     6   // periodic task released, arg: task id
+#define TRACE_EVENT_USER      256   // first event id free for the sketches
+
+#define TRACE(event, arg) do { if (traceEnabled) traceEvent((event), (arg)); } while (0)
+#define TRACE_ISR_NUMBER()  (HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_VEC_ACT_M)
+#define TRACE_ISR_ENTER()   TRACE(TRACE_EVENT_ISR_ENTER, TRACE_ISR_NUMBER())
+#define TRACE_ISR_EXIT()    TRACE(TRACE_EVENT_ISR_EXIT, TRACE_ISR_NUMBER())
+
 #ifdef __cplusplus
 #include "WCharacter.h"
 #include "WString.h"
@@ -315,6 +360,8 @@ uint16_t makeWord(byte h, byte l);
 
 unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000L);
 
+void traceDump(Print &out);
+
 void tone(uint8_t _pin, unsigned int frequency);
 void tone(uint8_t _pin, unsigned int frequency, unsigned long duration);
 void noTone(uint8_t _pin);
@@ -50,15 +50,24 @@
 #include "driverlib/pin_map.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/uart.h"
+#include "driverlib/udma.h"
 #include "HardwareSerial.h"
 
 #define TX_BUFFER_EMPTY    (txReadIndex == txWriteIndex)
-#define TX_BUFFER_FULL     (((txWriteIndex + 1) % txBufferSize) == txReadIndex)
+#define TX_BUFFER_FULL     (((txWriteIndex + 1) & (txBufferSize - 1)) == txReadIndex)
 
 #define RX_BUFFER_EMPTY    (rxReadIndex == rxWriteIndex)
-#define RX_BUFFER_FULL     (((rxWriteIndex + 1) % rxBufferSize) == rxReadIndex)
+#define RX_BUFFER_FULL     (((rxWriteIndex + 1) & (rxBufferSize - 1)) == rxReadIndex)
 
 #define UART_BASE g_ulUARTBase[uartModule]
+#define UART_DMA_RX_CHANNEL (g_ulUARTDMA[uartModule][0] & 0xFF)
+#define UART_DMA_TX_CHANNEL (g_ulUARTDMA[uartModule][1] & 0xFF)
+
+//
+// Maximum size of a uDMA transfer: the receive buffer is split into two
+// halves of at most this size.
+//
+#define UART_DMA_MAX_ITEMS 1024
 
 static const unsigned long g_ulUARTBase[8] =
 {
@@ -154,6 +163,19 @@ static const unsigned long g_ulUARTPins[8] =
 #endif
 };
 
+//*****************************************************************************
+//
+// The list of uDMA RX and TX channels (with their channel assignment).
+//
+//*****************************************************************************
+static const unsigned long g_ulUARTDMA[8][2] =
+{
+    {UDMA_CH8_UART0RX, UDMA_CH9_UART0TX}, {UDMA_CH22_UART1RX, UDMA_CH23_UART1TX},
+    {UDMA_CH12_UART2RX, UDMA_CH13_UART2TX}, {UDMA_CH16_UART3RX, UDMA_CH17_UART3TX},
+    {UDMA_CH18_UART4RX, UDMA_CH19_UART4TX}, {UDMA_CH6_UART5RX, UDMA_CH7_UART5TX},
+    {UDMA_CH10_UART6RX, UDMA_CH11_UART6TX}, {UDMA_CH20_UART7RX, UDMA_CH21_UART7TX}
+};
+
 // Constructors ////////////////////////////////////////////////////////////////
 HardwareSerial::HardwareSerial(void)
 {
@@ -167,6 +189,12 @@ HardwareSerial::HardwareSerial(void)
     rxBuffer = (unsigned char *) 0xFFFFFFFF;
     txBufferSize = SERIAL_BUFFER_SIZE;
     rxBufferSize = SERIAL_BUFFER_SIZE;
+    dmaMode = false;
+    txDMACount = 0;
+    txFIFOLevel = UART_FIFO_TX1_8;
+    rxFIFOLevel = UART_FIFO_RX1_8;
+    rxInts = UART_INT_RX | UART_INT_RT;
+    memset(&stats, 0, sizeof(stats));
 }
 
 HardwareSerial::HardwareSerial(unsigned long module) 
@@ -181,6 +209,12 @@ HardwareSerial::HardwareSerial(unsigned long module)
     rxBuffer = (unsigned char *) 0xFFFFFFFF;
     txBufferSize = SERIAL_BUFFER_SIZE;
     rxBufferSize = SERIAL_BUFFER_SIZE;
+    dmaMode = false;
+    txDMACount = 0;
+    txFIFOLevel = UART_FIFO_TX1_8;
+    rxFIFOLevel = UART_FIFO_RX1_8;
+    rxInts = UART_INT_RX | UART_INT_RT;
+    memset(&stats, 0, sizeof(stats));
 }
 // Private Methods //////////////////////////////////////////////////////////////
 void
@@ -189,6 +223,7 @@ HardwareSerial::flushAll(void)
     // wait for transmission of outgoing data
     while(!TX_BUFFER_EMPTY)
     {
+        primeTransmit(UART_BASE);
     }
     txReadIndex = 0;
     txWriteIndex = 0;
@@ -203,34 +238,57 @@ HardwareSerial::flushAll(void)
 void
 HardwareSerial::primeTransmit(unsigned long ulBase)
 {
+    if(dmaMode)
+    {
+        CriticalSection lock(SERIAL_INT_PRIORITY);
+
+        //
+        // Release the characters of the last transfer once it is done, then
+        // send the next contiguous run of the transmit buffer. The buffer
+        // wraps at most once: the rest goes with the next transfer.
+        //
+        if(txDMACount && !MAP_uDMAChannelIsEnabled(UART_DMA_TX_CHANNEL))
+        {
+            txReadIndex = (txReadIndex + txDMACount) & (txBufferSize - 1);
+            txDMACount = 0;
+        }
+        if(!txDMACount && !TX_BUFFER_EMPTY)
+        {
+            txDMACount = ((txWriteIndex > txReadIndex) ? txWriteIndex : txBufferSize) - txReadIndex;
+            if(txDMACount > UART_DMA_MAX_ITEMS)
+                txDMACount = UART_DMA_MAX_ITEMS;
+            MAP_uDMAChannelTransferSet(UART_DMA_TX_CHANNEL | UDMA_PRI_SELECT,
+                                       UDMA_MODE_BASIC, txBuffer + txReadIndex,
+                                       (void *)(ulBase + UART_O_DR), txDMACount);
+            MAP_uDMAChannelEnable(UART_DMA_TX_CHANNEL);
+        }
+        return;
+    }
+
     //
     // Do we have any data to transmit?
     //
     if(!TX_BUFFER_EMPTY)
     {
         //
-        // Disable the UART interrupt. If we don't do this there is a race
-        // condition which can cause the read index to be corrupted.
+        // Mask the UART interrupt while the FIFO is filled. If we don't
+        // do this there is a race condition which can cause the read
+        // index to be corrupted. The more urgent interrupts still run.
         //
-        ROM_IntDisable(g_ulUARTInt[uartModule]);
+        CriticalSection lock(SERIAL_INT_PRIORITY);
+
         //
-        // Yes - take some characters out of the transmit buffer and feed
-        // them to the UART transmit FIFO.
+        // Yes - take as many characters out of the transmit buffer as the
+        // UART transmit FIFO can hold, without waiting. If characters are
+        // left, the FIFO is full: the transmit interrupt refills it when
+        // its level drops below 1/8.
         //
-        while(!TX_BUFFER_EMPTY)
-        {
-            while(ROM_UARTSpaceAvail(ulBase) && !TX_BUFFER_EMPTY){
-                ROM_UARTCharPutNonBlocking(ulBase,
-                                       txBuffer[txReadIndex]);
+        while(ROM_UARTSpaceAvail(ulBase) && !TX_BUFFER_EMPTY){
+            ROM_UARTCharPutNonBlocking(ulBase,
+                                   txBuffer[txReadIndex]);
 
-                txReadIndex = (txReadIndex + 1) % txBufferSize;
-            }
+            txReadIndex = (txReadIndex + 1) & (txBufferSize - 1);
         }
-
-        //
-        // Reenable the UART interrupt.
-        //
-        ROM_IntEnable(g_ulUARTInt[uartModule]);
     }
 }
 
@@ -255,13 +313,15 @@ HardwareSerial::begin(unsigned long baud)
                             (UART_CONFIG_PAR_NONE | UART_CONFIG_STOP_ONE |
                              UART_CONFIG_WLEN_8));
     //
-    // Set the UART to interrupt whenever the TX FIFO is almost empty or
-    // when any character is received.
+    // Set the UART to interrupt when the TX FIFO drops below its level,
+    // when the RX FIFO reaches its level, and when the line goes idle with
+    // characters in the RX FIFO (1/8 by default, see setFIFOLevel()).
     //
-    ROM_UARTFIFOLevelSet(UART_BASE, UART_FIFO_TX1_8, UART_FIFO_RX1_8);
+    ROM_UARTFIFOLevelSet(UART_BASE, txFIFOLevel, rxFIFOLevel);
     flushAll();
     ROM_UARTIntDisable(UART_BASE, 0xFFFFFFFF);
-    ROM_UARTIntEnable(UART_BASE, UART_INT_RX | UART_INT_RT);
+    ROM_UARTIntEnable(UART_BASE, rxInts);
+    ROM_IntPrioritySet(g_ulUARTInt[uartModule], SERIAL_INT_PRIORITY);
     ROM_IntEnable(g_ulUARTInt[uartModule]);
 
     //
@@ -278,20 +338,269 @@ HardwareSerial::begin(unsigned long baud)
     rxBuffer = (unsigned char *) malloc(rxBufferSize);
 
     SysCtlDelay(100);
+
+    if(dmaMode)
+    {
+        startDMA();
+    }
+}
+
+//
+// Selects the uDMA mode, before or after begin(). The receive buffer is
+// then filled by a ping-pong transfer, the transmit buffer is sent by
+// uDMA transfers: the UART interrupt only runs when a transfer completes,
+// or when the line goes idle while characters are left in the RX FIFO.
+// In this mode the characters that are not read within one receive
+// buffer are overwritten.
+//
+void
+HardwareSerial::setDMA(bool enable)
+{
+    if(enable == dmaMode)
+        return;
+    if(txBuffer == (unsigned char *)0xFFFFFFFF)
+    {
+        // not started yet: begin() starts the uDMA
+        dmaMode = enable;
+        return;
+    }
+    flush();
+    if(enable)
+        startDMA();
+    else
+        stopDMA();
+}
+
+//
+// Arms the primary or alternate transfer of the receive ping-pong, each one
+// fills half of the receive buffer.
+//
+void
+HardwareSerial::rxDMAArm(unsigned long select)
+{
+    unsigned long half = rxBufferSize / 2;
+
+    MAP_uDMAChannelTransferSet(UART_DMA_RX_CHANNEL | select, UDMA_MODE_PINGPONG,
+                               (void *)(UART_BASE + UART_O_DR),
+                               rxBuffer + ((select == UDMA_ALT_SELECT) ? half : 0),
+                               half);
+}
+
+//
+// Updates the write index of the receive buffer from the progress of the
+// transfer that is running.
+//
+void
+HardwareSerial::rxDMASync(void)
+{
+    CriticalSection lock(SERIAL_INT_PRIORITY);
+    unsigned long half = rxBufferSize / 2;
+    unsigned long select =
+        (MAP_uDMAChannelAttributeGet(UART_DMA_RX_CHANNEL) & UDMA_ATTR_ALTSELECT) ?
+        UDMA_ALT_SELECT : UDMA_PRI_SELECT;
+    unsigned long index = ((select == UDMA_ALT_SELECT) ? half : 0) + half -
+        MAP_uDMAChannelSizeGet(UART_DMA_RX_CHANNEL | select);
+    unsigned long mask = rxBufferSize - 1;
+    unsigned long used = ((rxWriteIndex - rxReadIndex) & mask) +
+                         ((index - rxWriteIndex) & mask);
+
+    //
+    // The transfer overwrote characters that were not read: drop the
+    // oldest ones so that the buffer holds the last rxBufferSize - 1.
+    //
+    if(used > mask)
+    {
+        stats.dropped += used - mask;
+        rxReadIndex = (index + 1) & mask;
+    }
+    rxWriteIndex = index & mask;
+}
+
+void
+HardwareSerial::startDMA(void)
+{
+    CriticalSection lock(SERIAL_INT_PRIORITY);
+    unsigned long half = rxBufferSize / 2;
+
+    udmaInit();
+    dmaMode = true;
+    txDMACount = 0;
+    if(half > UART_DMA_MAX_ITEMS)
+        half = UART_DMA_MAX_ITEMS;
+    rxBufferSize = half * 2;
+    rxReadIndex = 0;
+    rxWriteIndex = 0;
+
+    MAP_uDMAChannelAssign(g_ulUARTDMA[uartModule][0]);
+    MAP_uDMAChannelAssign(g_ulUARTDMA[uartModule][1]);
+
+    //
+    // RX: bursts of 4 characters when the FIFO is half full. The characters
+    // left when the line goes idle raise the receive timeout interrupt.
+    //
+    MAP_uDMAChannelAttributeDisable(UART_DMA_RX_CHANNEL, UDMA_ATTR_ALTSELECT |
+                                    UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK);
+    MAP_uDMAChannelAttributeEnable(UART_DMA_RX_CHANNEL, UDMA_ATTR_USEBURST);
+    MAP_uDMAChannelControlSet(UART_DMA_RX_CHANNEL | UDMA_PRI_SELECT,
+                              UDMA_SIZE_8 | UDMA_SRC_INC_NONE | UDMA_DST_INC_8 | UDMA_ARB_4);
+    MAP_uDMAChannelControlSet(UART_DMA_RX_CHANNEL | UDMA_ALT_SELECT,
+                              UDMA_SIZE_8 | UDMA_SRC_INC_NONE | UDMA_DST_INC_8 | UDMA_ARB_4);
+    rxDMAArm(UDMA_PRI_SELECT);
+    rxDMAArm(UDMA_ALT_SELECT);
+
+    //
+    // TX: whenever the FIFO is half empty.
+    //
+    MAP_uDMAChannelAttributeDisable(UART_DMA_TX_CHANNEL, UDMA_ATTR_ALTSELECT |
+                                    UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK |
+                                    UDMA_ATTR_USEBURST);
+    MAP_uDMAChannelControlSet(UART_DMA_TX_CHANNEL | UDMA_PRI_SELECT,
+                              UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+
+    ROM_UARTFIFOLevelSet(UART_BASE, UART_FIFO_TX4_8, UART_FIFO_RX4_8);
+    ROM_UARTIntDisable(UART_BASE, UART_INT_RX | UART_INT_TX);
+    ROM_UARTIntEnable(UART_BASE, UART_INT_RT | UART_INT_OE | UART_INT_BE |
+                      UART_INT_PE | UART_INT_FE);
+#ifdef TARGET_IS_SNOWFLAKE_RA0
+    ROM_UARTIntEnable(UART_BASE, UART_INT_DMARX | UART_INT_DMATX);
+#endif
+    MAP_uDMAChannelEnable(UART_DMA_RX_CHANNEL);
+    MAP_UARTDMAEnable(UART_BASE, UART_DMA_RX | UART_DMA_TX);
+}
+
+void
+HardwareSerial::stopDMA(void)
+{
+    CriticalSection lock(SERIAL_INT_PRIORITY);
+
+    rxDMASync();
+    MAP_UARTDMADisable(UART_BASE, UART_DMA_RX | UART_DMA_TX);
+    MAP_uDMAChannelDisable(UART_DMA_RX_CHANNEL);
+    MAP_uDMAChannelDisable(UART_DMA_TX_CHANNEL);
+    dmaMode = false;
+    txDMACount = 0;
+
+    ROM_UARTFIFOLevelSet(UART_BASE, txFIFOLevel, rxFIFOLevel);
+    ROM_UARTIntDisable(UART_BASE, UART_INT_RT | UART_INT_OE | UART_INT_BE |
+                       UART_INT_PE | UART_INT_FE);
+#ifdef TARGET_IS_SNOWFLAKE_RA0
+    ROM_UARTIntDisable(UART_BASE, UART_INT_DMARX | UART_INT_DMATX);
+#endif
+    ROM_UARTIntEnable(UART_BASE, rxInts);
+}
+
+//
+// Rounds a buffer size up to a power of 2, so that the indexes wrap with
+// a mask.
+//
+static unsigned long
+roundBufferSize(unsigned long size)
+{
+    if(size < 2)
+        return 2;
+    return 1UL << (32 - __builtin_clz(size - 1));
 }
 
 void
 HardwareSerial::setBufferSize(unsigned long txsize, unsigned long rxsize)
 {
     if (txsize > 0)
-        txBufferSize = txsize;
+        txBufferSize = roundBufferSize(txsize);
     if (rxsize > 0)
-        rxBufferSize = rxsize;
+        rxBufferSize = roundBufferSize(rxsize);
+}
+
+//
+// Sets the FIFO levels that raise the UART interrupt, UART_FIFO_TXn_8 and
+// UART_FIFO_RXn_8 from driverlib/uart.h. A higher RX level means fewer
+// interrupts, a lower TX level fewer refills. The uDMA mode uses its own
+// levels.
+//
+void
+HardwareSerial::setFIFOLevel(unsigned long txLevel, unsigned long rxLevel)
+{
+    txFIFOLevel = txLevel;
+    rxFIFOLevel = rxLevel;
+    if(txBuffer != (unsigned char *)0xFFFFFFFF && !dmaMode)
+    {
+        ROM_UARTFIFOLevelSet(UART_BASE, txFIFOLevel, rxFIFOLevel);
+    }
+}
+
+//
+// Enables (default) or disables the receive timeout interrupt. The
+// timeout is fixed by the UART to 32 bit periods of idle line. Without
+// it, the characters below the RX FIFO level only reach the receive
+// buffer when available()/peek()/read() are called: fewer interrupts,
+// but a late wake up of the tasks blocked in waitReadable().
+//
+void
+HardwareSerial::setRxTimeout(bool enable)
+{
+    CriticalSection lock(SERIAL_INT_PRIORITY);
+
+    rxInts = enable ? (UART_INT_RX | UART_INT_RT) : UART_INT_RX;
+    if(txBuffer != (unsigned char *)0xFFFFFFFF && !dmaMode)
+    {
+        ROM_UARTIntDisable(UART_BASE, UART_INT_RT);
+        ROM_UARTIntEnable(UART_BASE, rxInts);
+    }
+}
+
+//
+// Copies the receive statistics counted since begin() or clearStats().
+// In the uDMA mode the errors are counted by interrupt, so several errors
+// between two interrupts count as one.
+//
+void
+HardwareSerial::getStats(serialStats_t *s)
+{
+    CriticalSection lock(SERIAL_INT_PRIORITY);
+
+    if(dmaMode)
+    {
+        rxDMASync();
+    }
+    *s = stats;
+}
+
+void
+HardwareSerial::clearStats(void)
+{
+    CriticalSection lock(SERIAL_INT_PRIORITY);
+
+    memset(&stats, 0, sizeof(stats));
+}
+
+//
+// Without the receive timeout interrupt, moves the characters left below
+// the RX FIFO level to the receive buffer.
+//
+void
+HardwareSerial::rxPoll(void)
+{
+    if(dmaMode)
+    {
+        rxDMASync();
+    }
+    else if(!(rxInts & UART_INT_RT) && ROM_UARTCharsAvail(UART_BASE))
+    {
+        CriticalSection lock(SERIAL_INT_PRIORITY);
+
+        UARTRxHandler();
+    }
 }
 
 void
 HardwareSerial::setModule(unsigned long module)
 {
+    if(dmaMode && txBuffer != (unsigned char *)0xFFFFFFFF)
+    {
+        // begin() starts the uDMA again on the new module
+        flush();
+        stopDMA();
+        dmaMode = true;
+    }
     ROM_UARTIntDisable(UART_BASE, UART_INT_RX | UART_INT_RT);
     ROM_IntDisable(g_ulUARTInt[uartModule]);
 	uartModule = module;
@@ -331,12 +640,18 @@ void HardwareSerial::end()
         ROM_IntMasterEnable();
     }
 
+    if(dmaMode)
+    {
+        stopDMA();
+        dmaMode = true;
+    }
     ROM_IntDisable(g_ulUARTInt[uartModule]);
     ROM_UARTIntDisable(UART_BASE, UART_INT_RX | UART_INT_RT);
 }
 
 int HardwareSerial::available(void)
 {
+    rxPoll();
     return((rxWriteIndex >= rxReadIndex) ?
 		(rxWriteIndex - rxReadIndex) : rxBufferSize - (rxReadIndex - rxWriteIndex));
 }
@@ -345,6 +660,8 @@ int HardwareSerial::peek(void)
 {
     unsigned char cChar = 0;
 
+    rxPoll();
+
     //
     // Wait for a character to be received.
     //
@@ -369,6 +686,7 @@ int HardwareSerial::peek(void)
 
 int HardwareSerial::read(void)
 {
+    rxPoll();
     if(RX_BUFFER_EMPTY) {
     	return -1;
     }
@@ -377,13 +695,77 @@ int HardwareSerial::read(void)
     // Read a character from the buffer.
     //
     unsigned char cChar = rxBuffer[rxReadIndex];
-	rxReadIndex = ((rxReadIndex) + 1) % rxBufferSize;
+	rxReadIndex = ((rxReadIndex) + 1) & (rxBufferSize - 1);
 	return cChar;
 }
 
+//
+// Points 'ptr' at the received characters up to the end of the receive
+// buffer. In the uDMA mode they are only valid until the transfer wraps
+// around the buffer.
+//
+size_t HardwareSerial::peekSpan(const uint8_t *&ptr)
+{
+    rxPoll();
+    unsigned long writeIndex = rxWriteIndex;
+
+    ptr = rxBuffer + rxReadIndex;
+    return(((writeIndex >= rxReadIndex) ? writeIndex : rxBufferSize) - rxReadIndex);
+}
+
+void HardwareSerial::consume(size_t n)
+{
+    unsigned long used = (rxWriteIndex - rxReadIndex) & (rxBufferSize - 1);
+
+    if(n > used)
+        n = used;
+    rxReadIndex = (rxReadIndex + n) & (rxBufferSize - 1);
+}
+
+//
+// Copies the received characters to 'buffer' one contiguous run of the
+// receive buffer at a time. Waits like Stream::readBytes() while the
+// receive buffer is empty.
+//
+size_t HardwareSerial::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+
+    while(count < length)
+    {
+        rxPoll();
+        unsigned long writeIndex = rxWriteIndex;
+        if(writeIndex == rxReadIndex)
+        {
+            int c = timedRead();
+            if(c < 0)
+                break;
+            buffer[count++] = (char)c;
+            continue;
+        }
+
+        unsigned long run = ((writeIndex > rxReadIndex) ? writeIndex : rxBufferSize) - rxReadIndex;
+        if(run > length - count)
+            run = length - count;
+        memcpy(buffer + count, rxBuffer + rxReadIndex, run);
+        rxReadIndex = (rxReadIndex + run) & (rxBufferSize - 1);
+        count += run;
+    }
+    return count;
+}
+
+//
+// Waits until all the characters written are sent. This is the only
+// transmit function that waits for the UART, write() only blocks while
+// the transmit buffer is full.
+//
 void HardwareSerial::flush()
 {
-    while(!TX_BUFFER_EMPTY);
+    while(!TX_BUFFER_EMPTY)
+    {
+        primeTransmit(UART_BASE);
+    }
+    while(ROM_UARTBusy(UART_BASE));
 }
 
 size_t HardwareSerial::write(uint8_t c)
@@ -408,16 +790,20 @@ size_t HardwareSerial::write(uint8_t c)
     {
         while (TX_BUFFER_FULL);
         txBuffer[txWriteIndex] = '\r';
-		txWriteIndex = (txWriteIndex + 1) % txBufferSize;
+		txWriteIndex = (txWriteIndex + 1) & (txBufferSize - 1);
         numTransmit ++;
     }
 */
     //
-    // Send the character to the UART output.
+    // Send the character to the UART output. If the buffer is full, feed
+    // the FIFO from here too: the transmit interrupt may be masked.
     //
-    while (TX_BUFFER_FULL);
+    while (TX_BUFFER_FULL)
+    {
+        primeTransmit(UART_BASE);
+    }
     txBuffer[txWriteIndex] = c;
-    txWriteIndex = (txWriteIndex + 1) % txBufferSize;
+    txWriteIndex = (txWriteIndex + 1) & (txBufferSize - 1);
     numTransmit ++;
 
     //
@@ -427,7 +813,10 @@ size_t HardwareSerial::write(uint8_t c)
     if(!TX_BUFFER_EMPTY)
     {
 	    primeTransmit(UART_BASE);
-        ROM_UARTIntEnable(UART_BASE, UART_INT_TX);
+        if(!dmaMode)
+        {
+            ROM_UARTIntEnable(UART_BASE, UART_INT_TX);
+        }
     }
 
     //
@@ -436,13 +825,65 @@ size_t HardwareSerial::write(uint8_t c)
     return(numTransmit);
 }
 
+//
+// Copies 'buffer' to the transmit buffer one contiguous run at a time,
+// instead of one write() call per character. Blocks while the transmit
+// buffer is full, like write(c).
+//
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    size_t count = 0;
+
+    while(count < size)
+    {
+        unsigned long space = (txReadIndex - txWriteIndex - 1) & (txBufferSize - 1);
+        if(!space)
+        {
+            primeTransmit(UART_BASE);
+            continue;
+        }
+
+        unsigned long run = txBufferSize - txWriteIndex;
+        if(run > space)
+            run = space;
+        if(run > size - count)
+            run = size - count;
+        memcpy(txBuffer + txWriteIndex, buffer + count, run);
+        txWriteIndex = (txWriteIndex + run) & (txBufferSize - 1);
+        count += run;
+
+        primeTransmit(UART_BASE);
+        if(!dmaMode)
+        {
+            ROM_UARTIntEnable(UART_BASE, UART_INT_TX);
+        }
+    }
+    return(count);
+}
+
+static void deferredRx(uint32_t serial)
+{
+    // rxPoll() from a task preempting the worker also drains the FIFO
+    CriticalSection lock(SERIAL_INT_PRIORITY);
+
+    ((HardwareSerial *)serial)->UARTRxHandler();
+}
+
 void HardwareSerial::UARTIntHandler(void){
     unsigned long ulInts;
-    long lChar;
+    TRACE_ISR_ENTER();
     // Get and clear the current interrupt source(s)
     //
     ulInts = ROM_UARTIntStatus(UART_BASE, true);
     ROM_UARTIntClear(UART_BASE, ulInts);
+    stats.interrupts++;
+
+    if(dmaMode)
+    {
+        UARTDMAHandler(ulInts);
+        TRACE_ISR_EXIT();
+        return;
+    }
 
     // Are we being interrupted because the TX FIFO has space available?
     //
@@ -463,32 +904,141 @@ void HardwareSerial::UARTIntHandler(void){
     }
     if(ulInts & (UART_INT_RX | UART_INT_RT))
     {
-        while(ROM_UARTCharsAvail(UART_BASE))
+        //
+        // With a worker task, empty the RX FIFO at thread level. The RX
+        // interrupts stay off until then, the FIFO keeps the characters.
+        //
+        if(hasDeferredWorker())
+        {
+            ROM_UARTIntDisable(UART_BASE, UART_INT_RX | UART_INT_RT);
+            if(deferWork(deferredRx, (uint32_t)this))
             {
+                TRACE_ISR_EXIT();
+                return;
+            }
+            ROM_UARTIntEnable(UART_BASE, rxInts);
+        }
+        UARTRxHandler();
+    }
+    TRACE_ISR_EXIT();
+}
+
+//
+// UART interrupt in uDMA mode: a transfer completed, or the line went idle.
+//
+void HardwareSerial::UARTDMAHandler(unsigned long ulInts)
+{
+    unsigned long index = rxWriteIndex;
+
+    if(ulInts & (UART_INT_OE | UART_INT_BE | UART_INT_PE | UART_INT_FE))
+    {
+        if(ulInts & UART_INT_OE)
+            stats.overruns++;
+        if(ulInts & UART_INT_BE)
+            stats.breaks++;
+        if(ulInts & UART_INT_PE)
+            stats.parityErrors++;
+        if(ulInts & UART_INT_FE)
+            stats.framingErrors++;
+        ROM_UARTRxErrorClear(UART_BASE);
+    }
 
-            //
-            // Read a character
-            //
-            lChar = ROM_UARTCharGetNonBlocking(UART_BASE);
-            //
-            // If there is space in the receive buffer, put the character
-            // there, otherwise throw it away.
-            //
-            uint8_t volatile full = RX_BUFFER_FULL;
-            if(full) break;
-
-            rxBuffer[rxWriteIndex] =
-                (unsigned char)(lChar & 0xFF);
-            rxWriteIndex = ((rxWriteIndex) + 1) % rxBufferSize;
-
-            //
-            // If we wrote anything to the transmit buffer, make sure it actually
-            // gets transmitted.
-            //
+    //
+    // Give the full halves of the receive buffer back to the ping-pong.
+    //
+    if(MAP_uDMAChannelModeGet(UART_DMA_RX_CHANNEL | UDMA_PRI_SELECT) == UDMA_MODE_STOP)
+    {
+        rxDMAArm(UDMA_PRI_SELECT);
+    }
+    if(MAP_uDMAChannelModeGet(UART_DMA_RX_CHANNEL | UDMA_ALT_SELECT) == UDMA_MODE_STOP)
+    {
+        rxDMAArm(UDMA_ALT_SELECT);
+    }
+    if(!MAP_uDMAChannelIsEnabled(UART_DMA_RX_CHANNEL))
+    {
+        MAP_uDMAChannelEnable(UART_DMA_RX_CHANNEL);
+    }
+
+    //
+    // Receive timeout: less than a burst is left in the RX FIFO, let single
+    // requests move it.
+    //
+    if(ulInts & UART_INT_RT)
+    {
+        MAP_uDMAChannelAttributeDisable(UART_DMA_RX_CHANNEL, UDMA_ATTR_USEBURST);
+        while(ROM_UARTCharsAvail(UART_BASE) &&
+              MAP_uDMAChannelIsEnabled(UART_DMA_RX_CHANNEL))
+        {
         }
-        primeTransmit(UART_BASE);
-        ROM_UARTIntEnable(UART_BASE, UART_INT_TX);
+        MAP_uDMAChannelAttributeEnable(UART_DMA_RX_CHANNEL, UDMA_ATTR_USEBURST);
     }
+
+    rxDMASync();
+    if(rxWriteIndex != index)
+    {
+        notifyReaders(&_readers);
+    }
+
+    primeTransmit(UART_BASE);
+}
+
+//
+// Moves the received characters from the RX FIFO to the receive buffer.
+// Called from the interrupt handler, or from the worker task.
+//
+void HardwareSerial::UARTRxHandler(void)
+{
+    long lChar;
+    bool received = false;
+
+    while(ROM_UARTCharsAvail(UART_BASE))
+    {
+        //
+        // Read a character
+        //
+        lChar = ROM_UARTCharGetNonBlocking(UART_BASE);
+        if(lChar & (UART_DR_OE | UART_DR_BE | UART_DR_PE | UART_DR_FE))
+        {
+            if(lChar & UART_DR_OE)
+                stats.overruns++;
+            if(lChar & UART_DR_BE)
+                stats.breaks++;
+            if(lChar & UART_DR_PE)
+                stats.parityErrors++;
+            if(lChar & UART_DR_FE)
+                stats.framingErrors++;
+        }
+        //
+        // If there is space in the receive buffer, put the character
+        // there, otherwise throw it away.
+        //
+        if(RX_BUFFER_FULL)
+        {
+            stats.dropped++;
+            continue;
+        }
+
+        rxBuffer[rxWriteIndex] =
+            (unsigned char)(lChar & 0xFF);
+        rxWriteIndex = ((rxWriteIndex) + 1) & (rxBufferSize - 1);
+        received = true;
+    }
+
+    //
+    // Wake the tasks waiting for data in waitReadable().
+    //
+    if(received)
+    {
+        notifyReaders(&_readers);
+    }
+
+    //
+    // If we wrote anything to the transmit buffer, make sure it actually
+    // gets transmitted.
+    //
+    primeTransmit(UART_BASE);
+    ROM_UARTIntEnable(UART_BASE, UART_INT_TX);
+    ROM_UARTIntEnable(UART_BASE, rxInts);
 }
 
 void
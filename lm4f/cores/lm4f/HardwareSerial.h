@@ -36,7 +36,21 @@
 #include <inttypes.h>
 #include "Stream.h"
 
-#define SERIAL_BUFFER_SIZE     256
+#define SERIAL_BUFFER_SIZE     256	// buffer sizes are rounded up to a power of 2
+#define SERIAL_INT_PRIORITY    0xA0	// masked by CriticalSection in the driver
+
+//
+// Receive statistics of a port, see getStats().
+//
+typedef struct
+{
+    unsigned long interrupts;       // UART interrupt handler calls
+    unsigned long overruns;         // characters lost in the RX FIFO
+    unsigned long framingErrors;
+    unsigned long parityErrors;
+    unsigned long breaks;
+    unsigned long dropped;          // characters lost, receive buffer full
+} serialStats_t;
 
 #define UART1_PORTB	0 
 #define UART1_PORTC	1
@@ -55,8 +69,20 @@ class HardwareSerial : public Stream
         unsigned long rxReadIndex;
         unsigned long uartModule;
         unsigned long baudRate;
+        bool dmaMode;
+        unsigned long txDMACount;   // characters sent by the running TX transfer
+        unsigned long txFIFOLevel;
+        unsigned long rxFIFOLevel;
+        unsigned long rxInts;       // RX interrupts enabled outside of the uDMA mode
+        serialStats_t stats;
         void flushAll(void);
         void primeTransmit(unsigned long ulBase);
+        void startDMA(void);
+        void stopDMA(void);
+        void rxDMAArm(unsigned long select);
+        void rxDMASync(void);
+        void rxPoll(void);
+        void UARTDMAHandler(unsigned long ulInts);
 
     public:
 		HardwareSerial(void);
@@ -65,14 +91,24 @@ class HardwareSerial : public Stream
 		void setBufferSize(unsigned long, unsigned long);
 		void setModule(unsigned long);
 		void setPins(unsigned long);
+		void setDMA(bool);
+		void setFIFOLevel(unsigned long, unsigned long);
+		void setRxTimeout(bool);
+		void getStats(serialStats_t *);
+		void clearStats(void);
 		void end(void);
 		virtual int available(void);
 		virtual int peek(void);
 		virtual int read(void);
 		virtual void flush(void);
+		virtual size_t peekSpan(const uint8_t *&ptr);
+		virtual void consume(size_t n);
         void UARTIntHandler(void);
+        void UARTRxHandler(void);
         virtual size_t write(uint8_t c);
-		using Print::write; // pull in write(str) and write(buf, size) from Print
+        virtual size_t write(const uint8_t *buffer, size_t size);
+		using Print::write; // pull in write(str) from Print
+		virtual size_t readBytes(char *buffer, size_t length);
         
 };
 
@@ -24,7 +24,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
+#include <stddef.h>
+#include <wchar.h>
 #include "Energia.h"
+#include "wiring_format.h"
 #include "Print.h"
 
 // Public Methods //////////////////////////////////////////////////////////////
@@ -202,103 +206,392 @@ size_t Print::println(const Printable& x)
     return n;
 }
 
-// Private Methods /////////////////////////////////////////////////////////////
-
-size_t Print::printNumber(unsigned long n, uint8_t base) {
-    char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-    char *str = &buf[sizeof(buf) - 1];
-
-    *str = '\0';
+// Output of printf(): the text is sent in write(buffer, size) batches
+// instead of one write() per character.
+struct PrintBuffer
+{
+    Print *out;
+    size_t n;
+    uint8_t len;
+    char buf[PRINTF_BUFFER_SIZE];
+
+    void put(char c) {
+        if (len == sizeof(buf)) flush();
+        buf[len++] = c;
+    }
+    void put(const char *s, size_t size) {
+        while (size--) put(*s++);
+    }
+    void pad(char c, int count) {
+        while (count-- > 0) put(c);
+    }
+    void flush() {
+        if (len) n += out->write((const uint8_t *)buf, len);
+        len = 0;
+    }
+};
 
-    // prevent crash if called with base == 1
-    if (base < 2) base = 10;
+// Length modifiers of the printf() conversions
+enum PrintfLength {
+    LEN_INT, LEN_CHAR, LEN_SHORT, LEN_LONG, LEN_LLONG, LEN_SIZE, LEN_PTRDIFF, LEN_LDOUBLE
+};
 
-    do {
-        unsigned long m = n;
+// Writes the digits of 'n' like format_ulong(). Only the digits above an
+// unsigned long take a long long division.
+static char *format_ullong(char *end, unsigned long long n, unsigned char base)
+{
+    while (n > ULONG_MAX) {
+        char c = n % base;
+        *--end = c < 10 ? c + '0' : c + 'A' - 10;
         n /= base;
-        char c = m - base * n;
-        *--str = c < 10 ? c + '0' : c + 'A' - 10;
-    } while(n);
-
-    return write(str);
+    }
+    return format_ulong(end, (unsigned long)n, base);
 }
 
-size_t Print::printFloat(double number, uint8_t digits) 
-{ 
-    size_t n = 0;
-
-    // Handle negative numbers
-    if (number < 0.0)
-    {
-        n += print('-');
-        number = -number;
+// Writes the mantissa in [1, 10) of 'number', not negative, with 'digits'
+// decimals through format_double(), and stores its power of 10 in 'exp'.
+// Returns the number of characters written.
+static int format_mantissa(char *buf, double number, unsigned char digits, int *exp)
+{
+    int e = 0;
+    int len;
+
+    if (number != 0.0) {
+        while (number >= 1e8) { number /= 1e8; e += 8; }
+        while (number >= 10.0) { number /= 10.0; e++; }
+        while (number < 1e-8) { number *= 1e8; e -= 8; }
+        while (number < 1.0) { number *= 10.0; e--; }
+    }
+    len = format_double(buf, number, digits);
+    if (len > 1 && buf[0] == '1' && buf[1] == '0') {
+        // 9.99... rounded up to 10
+        len = format_double(buf, number / 10.0, digits);
+        e++;
     }
+    *exp = e;
+    return len;
+}
 
-    // Round correctly so that print(1.999, 2) prints as "2.00"
-    double rounding = 0.5;
-    for (uint8_t i=0; i<digits; ++i)
-        rounding /= 10.0;
+// printf() subset: %d %i %u %x %X %o %c %s %p %f %F %e %E %g %G %n and
+// %%, the '-' '+' ' ' '#' and '0' flags, the width and precision, '*'
+// included, and the hh h l ll j z t and L lengths. %a and %A print as %e
+// and %E, %f beyond FORMAT_DOUBLE_MAX prints as %e, wide characters (%lc
+// %ls) are truncated to 8 bits, and the precision of the integers is
+// ignored. Every conversion GCC accepts takes its argument, so
+// format(printf) keeps the arguments in step.
+// The numbers go through wiring_format.c, not the C library printf.
+size_t Print::vprintf(const char *format, va_list args)
+{
+    PrintBuffer out;
+    char num[FORMAT_ULONG_SIZE + FORMAT_FLOAT_SIZE];
+    char *end = &num[sizeof(num)];
+    char exponent[6];
+
+    out.out = this;
+    out.n = 0;
+    out.len = 0;
+
+    while (*format) {
+        char c = *format++;
+        if (c != '%') {
+            out.put(c);
+            continue;
+        }
 
-    number += rounding;
+        bool left = false, zero = false, alt = false;
+        char plus = 0;
+        int width = 0, precision = -1, zeros = 0;
+        for (;; format++) {
+            if (*format == '-') left = true;
+            else if (*format == '0') zero = true;
+            else if (*format == '#') alt = true;
+            else if (*format == '+') plus = '+';
+            else if (*format == ' ' && !plus) plus = ' ';
+            else break;
+        }
+        if (*format == '*') {
+            width = va_arg(args, int);
+            if (width < 0) {
+                left = true;
+                width = -width;
+            }
+            format++;
+        } else {
+            while (*format >= '0' && *format <= '9') width = width * 10 + *format++ - '0';
+        }
+        if (*format == '.') {
+            format++;
+            precision = 0;
+            if (*format == '*') {
+                precision = va_arg(args, int);
+                format++;
+            } else {
+                while (*format >= '0' && *format <= '9') precision = precision * 10 + *format++ - '0';
+            }
+        }
+        PrintfLength length = LEN_INT;
+        switch (*format) {
+        case 'h':
+            length = LEN_SHORT;
+            if (*++format == 'h') {
+                length = LEN_CHAR;
+                format++;
+            }
+            break;
+        case 'l':
+            length = LEN_LONG;
+            if (*++format == 'l') {
+                length = LEN_LLONG;
+                format++;
+            }
+            break;
+        case 'j': length = LEN_LLONG; format++; break;
+        case 'z': length = LEN_SIZE; format++; break;
+        case 't': length = LEN_PTRDIFF; format++; break;
+        case 'L': length = LEN_LDOUBLE; format++; break;
+        }
 
-    // Extract the integer part of the number and print it
-    unsigned long int_part = (unsigned long)number;
-    double remainder = number - (double)int_part;
-    n += print(int_part);
+        const char *str = num;
+        const wchar_t *wstr = NULL;
+        size_t len = 0;
+        const char *prefix = "";
+        const char *suffix = "";
+        c = *format;
+        if (!c) break;
+        format++;
+        switch (c) {
+        case 'd':
+        case 'i': {
+            bool negative;
+            if (length == LEN_LLONG) {
+                long long v = va_arg(args, long long);
+                negative = v < 0;
+                str = format_ullong(end, negative ? -(unsigned long long)v : v, 10);
+            } else {
+                long v;
+                if (length == LEN_LONG) v = va_arg(args, long);
+                else if (length == LEN_SIZE || length == LEN_PTRDIFF) v = va_arg(args, ptrdiff_t);
+                else if (length == LEN_CHAR) v = (signed char)va_arg(args, int);
+                else if (length == LEN_SHORT) v = (short)va_arg(args, int);
+                else v = va_arg(args, int);
+                negative = v < 0;
+                str = format_ulong(end, negative ? -(unsigned long)v : v, 10);
+            }
+            if (negative) prefix = "-";
+            else if (plus) prefix = plus == '+' ? "+" : " ";
+            len = end - str;
+            break;
+        }
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'p': {
+            unsigned char base = c == 'u' ? 10 : c == 'o' ? 8 : 16;
+            char *digits;
+            bool nonzero;
+            if (c == 'p') {
+                digits = format_ulong(end, (unsigned long)va_arg(args, void *), 16);
+                nonzero = alt = true;
+            } else if (length == LEN_LLONG) {
+                unsigned long long v = va_arg(args, unsigned long long);
+                digits = format_ullong(end, v, base);
+                nonzero = v != 0;
+            } else {
+                unsigned long v;
+                if (length == LEN_LONG) v = va_arg(args, unsigned long);
+                else if (length == LEN_SIZE || length == LEN_PTRDIFF) v = va_arg(args, size_t);
+                else if (length == LEN_CHAR) v = (unsigned char)va_arg(args, unsigned int);
+                else if (length == LEN_SHORT) v = (unsigned short)va_arg(args, unsigned int);
+                else v = va_arg(args, unsigned int);
+                digits = format_ulong(end, v, base);
+                nonzero = v != 0;
+            }
+            if (c != 'X') {
+                for (char *p = digits; p < end; p++)
+                    if (*p >= 'A') *p += 'a' - 'A';
+            }
+            if (alt && nonzero && c != 'u')
+                prefix = c == 'o' ? "0" : c == 'X' ? "0X" : "0x";
+            str = digits;
+            len = end - str;
+            break;
+        }
+        case 'c':
+            if (length == LEN_LONG) num[0] = (char)va_arg(args, wint_t);
+            else num[0] = (char)va_arg(args, int);
+            len = 1;
+            break;
+        case 's':
+            if (length == LEN_LONG) {
+                wstr = va_arg(args, const wchar_t *);
+                if (!wstr) wstr = L"(null)";
+                while ((precision < 0 || (int)len < precision) && wstr[len]) len++;
+                break;
+            }
+            str = va_arg(args, const char *);
+            if (!str) str = "(null)";
+            while ((precision < 0 || (int)len < precision) && str[len]) len++;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A': {
+            double v = length == LEN_LDOUBLE ? (double)va_arg(args, long double) : va_arg(args, double);
+            bool upper = c < 'a';
+            char conversion = c | ('a' - 'A');
+            bool strip = false;
+            int exp = 0;
+
+            if (v < 0) {
+                prefix = "-";
+                v = -v;
+            } else if (plus) {
+                prefix = plus == '+' ? "+" : " ";
+            }
+            if (isnan(v) || isinf(v)) {
+                str = isnan(v) ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf");
+                len = 3;
+                zero = false;
+                break;
+            }
+            if (precision < 0) precision = 6;
+            if (conversion == 'a') {
+                conversion = 'e';
+            } else if (conversion == 'g') {
+                // %e below 1e-4, from 10^precision or beyond the integer part
+                // of format_double(), %f otherwise, without the trailing zeros
+                // unless '#'
+                if (precision == 0) precision = 1;
+                format_mantissa(num, v, precision - 1, &exp);
+                if (exp < -4 || exp >= precision || v > FORMAT_DOUBLE_MAX) {
+                    conversion = 'e';
+                    precision--;
+                } else {
+                    conversion = 'f';
+                    precision -= exp + 1;
+                }
+                strip = !alt;
+            }
+            if (conversion == 'f' && v > FORMAT_DOUBLE_MAX) {
+                // the integer part does not fit an unsigned long
+                conversion = 'e';
+            }
+            if (conversion == 'f') {
+                len = format_double(num, v, precision);
+            } else {
+                len = format_mantissa(num, v, precision, &exp);
+                char *p = exponent;
+                *p++ = upper ? 'E' : 'e';
+                *p++ = exp < 0 ? '-' : '+';
+                if (exp < 0) exp = -exp;
+                if (exp >= 100) *p++ = '0' + exp / 100;
+                *p++ = '0' + exp / 10 % 10;
+                *p++ = '0' + exp % 10;
+                *p = 0;
+                suffix = exponent;
+            }
+            // Decimals beyond FORMAT_MAX_DECIMALS are zeros
+            if (precision > FORMAT_MAX_DECIMALS) zeros = precision - FORMAT_MAX_DECIMALS;
+            if (strip) {
+                zeros = 0;
+                if (precision) {
+                    while (num[len - 1] == '0') len--;
+                    if (num[len - 1] == '.') len--;
+                }
+            } else if (alt && !precision) {
+                num[len++] = '.';
+            }
+            break;
+        }
+        case 'n': {
+            // stores the characters written so far, prints nothing
+            size_t count = out.n + out.len;
+            void *p = va_arg(args, void *);
+            if (length == LEN_CHAR) *(signed char *)p = count;
+            else if (length == LEN_SHORT) *(short *)p = count;
+            else if (length == LEN_LONG) *(long *)p = count;
+            else if (length == LEN_LLONG) *(long long *)p = count;
+            else if (length == LEN_SIZE) *(size_t *)p = count;
+            else if (length == LEN_PTRDIFF) *(ptrdiff_t *)p = count;
+            else *(int *)p = count;
+            continue;
+        }
+        case '%':
+            num[0] = '%';
+            len = 1;
+            break;
+        default:
+            // unknown conversion: printed as is
+            num[0] = '%';
+            num[1] = c;
+            len = 2;
+            break;
+        }
 
-    // Print the decimal point, but only if there are digits beyond
-    if (digits > 0) {
-        n += print(".");
+        size_t prefixLen = strlen(prefix);
+        size_t suffixLen = strlen(suffix);
+        int padding = width - (int)(len + prefixLen + suffixLen) - zeros;
+        if (!left && !zero) out.pad(' ', padding);
+        out.put(prefix, prefixLen);
+        if (!left && zero) out.pad('0', padding);
+        if (wstr) {
+            for (size_t i = 0; i < len; i++) out.put((char)wstr[i]);
+        } else {
+            out.put(str, len);
+        }
+        out.pad('0', zeros);
+        out.put(suffix, suffixLen);
+        if (left) out.pad(' ', padding);
     }
 
-    // Extract digits from the remainder one at a time
-    while (digits-- > 0)
-    {
-        remainder *= 10.0;
-        int toPrint = int(remainder);
-        n += print(toPrint);
-        remainder -= toPrint;
-    }
+    out.flush();
+    return out.n;
+}
 
+size_t Print::printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    size_t n = vprintf(format, args);
+    va_end(args);
     return n;
 }
 
-size_t Print::printFloat(float number, uint8_t digits)
-{
-    size_t n = 0;
+// Private Methods /////////////////////////////////////////////////////////////
 
-    // Handle negative numbers
-    if (number < 0.0)
-    {
-        n += print('-');
-        number = -number;
-    }
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+    char buf[FORMAT_ULONG_SIZE];
+    char *end = &buf[sizeof(buf)];
+    char *str = format_ulong(end, n, base);
 
-    // Round correctly so that print(1.999, 2) prints as "2.00"
-    float rounding = 0.5;
-    for (uint8_t i=0; i<digits; ++i)
-        rounding /= 10.0;
+    return write((const uint8_t *)str, end - str);
+}
 
-    number += rounding;
+size_t Print::printFloat(double number, uint8_t digits) 
+{ 
+    char buf[FORMAT_FLOAT_SIZE];
+    size_t n = write((const uint8_t *)buf, format_double(buf, number, digits));
 
-    // Extract the integer part of the number and print it
-    unsigned long int_part = (unsigned long)number;
-    float remainder = number - (float)int_part;
-    n += print(int_part);
+    // Decimals beyond FORMAT_MAX_DECIMALS are zeros
+    while (digits-- > FORMAT_MAX_DECIMALS)
+        n += print('0');
 
-    // Print the decimal point, but only if there are digits beyond
-    if (digits > 0) {
-        n += print(".");
-    }
+    return n;
+}
 
-    // Extract digits from the remainder one at a time
-    while (digits-- > 0)
-    {
-        remainder *= 10.0;
-        int toPrint = int(remainder);
-        n += print(toPrint);
-        remainder -= toPrint;
-    }
+size_t Print::printFloat(float number, uint8_t digits)
+{
+    char buf[FORMAT_FLOAT_SIZE];
+    size_t n = write((const uint8_t *)buf, format_float(buf, number, digits));
+
+    // Decimals beyond FORMAT_MAX_DECIMALS are zeros
+    while (digits-- > FORMAT_MAX_DECIMALS)
+        n += print('0');
 
     return n;
 }
@@ -28,6 +28,14 @@
 
 extern "C" {
 	__attribute__((weak)) void cmt_yeld();
+	__attribute__((weak)) void mt_notify(volatile unsigned int *list);
+}
+
+// wakes the tasks blocked in waitReadable(), if the Multitask library is linked
+void Stream::notifyReaders(volatile unsigned int *readers)
+{
+  if (*readers && mt_notify)
+    mt_notify(readers);
 }
 
 // private method to read stream with timeout
@@ -43,6 +43,7 @@ class Stream : public Print
     int timedRead();    // private method to read stream with timeout
     int timedPeek();    // private method to peek stream with timeout
     int peekNextDigit(); // returns the next numeric digit in the stream or -1 if timeout
+    volatile unsigned int _readers;  // tasks blocked in waitReadable() (Multitask library)
 
   public:
     virtual int available() = 0;
@@ -50,7 +51,21 @@ class Stream : public Print
     virtual int peek() = 0;
     virtual void flush() = 0;
 
-    Stream() {_timeout=1000;}
+    // zero-copy access to the received data: points 'ptr' at the largest
+    // contiguous run of bytes that can be read without copying, and returns
+    // its length (0 if there is none, or if the stream has no buffer).
+    // The bytes stay in the stream until consume(n) drops the first n.
+    virtual size_t peekSpan(const uint8_t *&ptr) { ptr = NULL; return 0; }
+    virtual void consume(size_t n) { while (n-- && read() >= 0); }
+
+    Stream() {_timeout=1000; _readers=0;}
+
+    // wait list of the tasks blocked in waitReadable() on this stream
+    virtual volatile unsigned int *readers() { return &_readers; }
+
+    // wakes the tasks waiting on 'readers', called when data arrives or the
+    // stream is closed. Can be called from interrupt handlers.
+    static void notifyReaders(volatile unsigned int *readers);
 
 // parsing methods
 
@@ -73,7 +88,7 @@ class Stream : public Print
 
   float parseFloat();               // float version of parseInt
 
-  size_t readBytes( char *buffer, size_t length); // read chars from stream into buffer
+  virtual size_t readBytes( char *buffer, size_t length); // read chars from stream into buffer
   // terminates if length characters have been read or timeout (see setTimeout)
   // returns the number of characters placed in the buffer (0 means no valid data found)
 
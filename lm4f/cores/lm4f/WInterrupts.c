@@ -68,6 +68,7 @@ void GPIOXIntHandler(uint32_t base, void (**funcs)(void))
 	uint32_t i;
 	uint32_t isr = GPIOIntStatus(base, true);
 
+	TRACE_ISR_ENTER();
 	GPIOIntClear(base, isr);
 
 	for (i=0; i<8; i++, isr>>=1) {
@@ -76,6 +77,7 @@ void GPIOXIntHandler(uint32_t base, void (**funcs)(void))
 		if (funcs[i])
 			funcs[i]();
 	}
+	TRACE_ISR_EXIT();
 }
 
 void GPIOAIntHandler(void)
@@ -66,5 +66,6 @@ int main(void)
 	for (;;) {
 		loop();
 		if (serialEventRun) serialEventRun();
+		runDeferredWork();
 	}
 }
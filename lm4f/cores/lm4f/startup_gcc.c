@@ -95,6 +95,7 @@ __attribute__((weak)) void UARTIntHandler7(void) {}
 __attribute__((weak)) void ToneIntHandler(void) {}
 __attribute__((weak)) void I2CIntHandler(void) {}
 __attribute__((weak)) void Timer5IntHandler(void) {}
+__attribute__((weak)) void PendSVIntHandler(void) {}
 
 
 __attribute__((weak)) void Timer0AIntHandler(void) {}
@@ -111,6 +112,7 @@ __attribute__((weak)) void Timer6AIntHandler(void) {}
 __attribute__((weak)) void Timer6BIntHandler(void) {}
 __attribute__((weak)) void Timer7AIntHandler(void) {}
 __attribute__((weak)) void Timer7BIntHandler(void) {}
+__attribute__((weak)) void WideTimer5AIntHandler(void) {}
 
 
 //*****************************************************************************
@@ -143,7 +145,7 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // SVCall handler
     IntDefaultHandler,                      // Debug monitor handler
     0,                                      // Reserved
-    IntDefaultHandler,                      // The PendSV handler
+    PendSVIntHandler,                       // The PendSV handler
     SysTickIntHandler,                      // The SysTick handler
     GPIOAIntHandler,                        // GPIO Port A
     GPIOBIntHandler,                        // GPIO Port B
@@ -249,7 +251,7 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // Wide Timer 3 subtimer B
     IntDefaultHandler,                      // Wide Timer 4 subtimer A
     IntDefaultHandler,                      // Wide Timer 4 subtimer B
-    IntDefaultHandler,                      // Wide Timer 5 subtimer A
+    WideTimer5AIntHandler,                  // Wide Timer 5 subtimer A
     IntDefaultHandler,                      // Wide Timer 5 subtimer B
     IntDefaultHandler,                      // FPU
     IntDefaultHandler,                      // PECI 0
@@ -303,7 +305,7 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // SVCall handler
     IntDefaultHandler,                      // Debug monitor handler
     0,                                      // Reserved
-    IntDefaultHandler,                      // The PendSV handler
+    PendSVIntHandler,                       // The PendSV handler
     SysTickIntHandler,                      // The SysTick handler
     GPIOAIntHandler,                        // GPIO Port A
     GPIOBIntHandler,                        // GPIO Port B
@@ -29,21 +29,43 @@
   Boston, MA  02111-1307  USA
  */
 #include "Energia.h"
+#include "wiring_private.h"
 #include "inc/hw_ints.h"
 #include "inc/hw_timer.h"
 #include "driverlib/rom.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/timer.h"
+#include "driverlib/cpu.h"
 
 __attribute__((weak)) void cmt_yeld();
-
-static void (*SysTickCbFuncs[8])(uint32_t ui32TimeMS);
+__attribute__((weak)) int mt_delay(uint32_t ms);
+__attribute__((weak)) void mt_tick(unsigned long now);
+__attribute__((weak)) unsigned long mt_next_tick(unsigned long now);
 
 #define SYSTICKMS               (1000 / SYSTICKHZ)
 #define SYSTICKHZ               100
 
+/* priority of the millisecond tick, which runs the software timers: the
+ * priority the SysTick callbacks ran at */
+#define TIMER_INT_PRIORITY      0x80
+
 static unsigned long milliseconds = 0;
-#define SYSTICK_INT_PRIORITY    0x80
+
+/*
+ * 64-bit cycle count: DWT CYCCNT extended by the count of its wraps.
+ * cyclesLast is the last CYCCNT read, a wrap is seen when CYCCNT goes back
+ * below it: cycles64() must run at least once per wrap (53s at 80MHz),
+ * which the Timer5 tick does. cyclesOffset adds the cycles the DWT
+ * did not count while the core clock was gated by timerSleep().
+ */
+static uint32_t cyclesLast = 0;
+static uint32_t cyclesHigh = 0;
+static uint64_t cyclesOffset = 0;
+
+/* nanoseconds per cycle in 32.32 fixed point, for nanos() */
+#define NANOS_MHZ               (F_CPU / 1000000)
+#define NANOS_PER_CYCLE         (1000 / NANOS_MHZ)
+#define NANOS_PER_CYCLE_FRAC    ((uint32_t)(((uint64_t)(1000 % NANOS_MHZ) << 32) / NANOS_MHZ))
 void timerInit()
 {
 #ifdef TARGET_IS_BLIZZARD_RB1
@@ -60,13 +82,12 @@ void timerInit()
 #endif
 
     //
-    //  SysTick is used for delay() and delayMicroseconds()
+    //  SysTick is used for delayMicroseconds(), its interrupt is not
+    //  used: periodic callbacks are software timers (wiring_timer.c)
     //
 
     ROM_SysTickPeriodSet(F_CPU / SYSTICKHZ);
     ROM_SysTickEnable();
-    ROM_IntPrioritySet(FAULT_SYSTICK, SYSTICK_INT_PRIORITY);
-    ROM_SysTickIntEnable();
     //
     //Initialize Timer5 to be used as time-tracker since beginning of time
     //
@@ -75,6 +96,15 @@ void timerInit()
 
     ROM_TimerLoadSet(TIMER5_BASE, TIMER_A, F_CPU/1000);
 
+    //
+    //  The DWT cycle counter starts with Timer5, so that cycles64() and
+    //  millis() count from the same origin
+    //
+    HWREG(NVIC_DBG_INT) |= DEMCR_TRCENA;
+    HWREG(DWT_CYCCNT) = 0;
+    HWREG(DWT_CTRL) |= DWT_CTRL_CYCCNTENA;
+
+    ROM_IntPrioritySet(INT_TIMER5A, TIMER_INT_PRIORITY);
     ROM_IntEnable(INT_TIMER5A);
     ROM_TimerIntEnable(TIMER5_BASE, TIMER_TIMA_TIMEOUT);
 
@@ -86,7 +116,52 @@ void timerInit()
 
 unsigned long micros(void)
 {
-	return (milliseconds * 1000) + (HWREG(TIMER5_BASE + TIMER_O_TAV) / (F_CPU/1000000));
+	uint32_t oldLevel = ROM_IntMasterDisable();
+	unsigned long ms = milliseconds;
+	unsigned long tav = HWREG(TIMER5_BASE + TIMER_O_TAV);
+
+	/* Timer5 wrapped but its interrupt did not run yet: read TAV again,
+	 * it now belongs to the next millisecond */
+	if (HWREG(TIMER5_BASE + TIMER_O_RIS) & TIMER_RIS_TATORIS) {
+		tav = HWREG(TIMER5_BASE + TIMER_O_TAV);
+		ms++;
+	}
+	if (!oldLevel)
+		ROM_IntMasterEnable();
+	return (ms * 1000) + (tav / (F_CPU/1000000));
+}
+
+/*
+ * Returns the CPU cycles since timerInit(), on 64 bits: it does not wrap.
+ * Can be called from any context, including interrupt handlers.
+ */
+uint64_t cycles64(void)
+{
+	uint32_t oldLevel = ROM_IntMasterDisable();
+	uint32_t now = HWREG(DWT_CYCCNT);
+	uint64_t cycles;
+
+	if (now < cyclesLast)
+		cyclesHigh++;
+	cyclesLast = now;
+	cycles = (((uint64_t) cyclesHigh << 32) | now) + cyclesOffset;
+	if (!oldLevel)
+		ROM_IntMasterEnable();
+	return cycles;
+}
+
+/*
+ * Returns the nanoseconds since timerInit(), on 64 bits, with the
+ * resolution of one CPU cycle.
+ */
+uint64_t nanos(void)
+{
+	uint64_t cycles = cycles64();
+
+	/* cycles * NANOS_PER_CYCLE.NANOS_PER_CYCLE_FRAC, without division */
+	return cycles * NANOS_PER_CYCLE
+		+ (cycles >> 32) * NANOS_PER_CYCLE_FRAC
+		+ (((cycles & 0xFFFFFFFF) * NANOS_PER_CYCLE_FRAC) >> 32);
 }
 
 unsigned long millis(void)
@@ -94,73 +169,188 @@ unsigned long millis(void)
 	return milliseconds;
 }
 
-void delayMicroseconds(unsigned int us)
+volatile boolean stay_asleep = false;
+
+/*
+ * Waits until cycles64() reaches 'end'. The CPU sleeps in timerSleep(),
+ * with the millisecond tick suppressed, and only spins on the cycle
+ * counter for the last fraction of millisecond. Interrupts are serviced
+ * as soon as they wake the CPU. With 'asleep' set, wakeup() ends the wait.
+ * Interrupt handlers, and code running with interrupts disabled or in a
+ * CriticalSection, can not sleep: they spin.
+ */
+static void waitCycles(uint64_t end, boolean asleep)
 {
-	volatile unsigned long elapsedTime;
-	unsigned long startTime = HWREG(NVIC_ST_CURRENT);
-	do{
-		elapsedTime = startTime-(HWREG(NVIC_ST_CURRENT) & 0x00FFFFFF);
+	uint64_t now, ms;
+
+	for (;;) {
+		uint32_t oldLevel = ROM_IntMasterDisable();
+
+		now = cycles64();
+		if (now >= end || (asleep && !stay_asleep)) {
+			if (!oldLevel)
+				ROM_IntMasterEnable();
+			return;
+		}
+		ms = (end - now) / (F_CPU/1000);
+		if (!ms || oldLevel || CPUbasepriGet() || (HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_VEC_ACT_M)) {
+			if (!oldLevel)
+				ROM_IntMasterEnable();
+			break;
+		}
+		timerSleep(ms < 0xFFFFFFFF ? ms : 0xFFFFFFFF);
+		/* runs the interrupt that woke the CPU */
+		ROM_IntMasterEnable();
 	}
-	while(elapsedTime <= us * (F_CPU/1000000));
+
+	while (cycles64() < end && !(asleep && !stay_asleep))
+		;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	waitCycles(cycles64() + (uint64_t) us * (F_CPU/1000000), false);
 }
 
 void delay(uint32_t ms)
 {
-	unsigned long i;
-	for(i=0; i<ms; i++){
-		delayMicroseconds(1000);
+	uint64_t end, next;
+	/* inside a Multitask task: sleep without being rescheduled */
+	if (mt_delay && mt_delay(ms))
+		return;
+	end = cycles64() + (uint64_t) ms * (F_CPU/1000);
+	if (!cmt_yeld) {
+		waitCycles(end, false);
+		return;
+	}
+	/* the cooperative tasks still run every millisecond */
+	while ((next = cycles64()) < end) {
+		next += F_CPU/1000;
+		waitCycles(next < end ? next : end, false);
 		cmt_yeld();
 	}
 }
 
-volatile boolean stay_asleep = false;
-
-/* TODO: Replace sleep, sleepSeconds and suspend with actual RTC+Hibernate module implementation */
+/*
+ * sleep(), sleepSeconds() and suspend() stop the CPU until the time has
+ * elapsed, or wakeup() is called from an interrupt handler.
+ */
 void sleep(uint32_t ms)
 {
-	unsigned long i;
-
 	stay_asleep = true;
-	for(i=0; i<ms && stay_asleep; i++) {
-		delayMicroseconds(1000);
-	}
+	waitCycles(cycles64() + (uint64_t) ms * (F_CPU/1000), true);
 	stay_asleep = false;
 }
 
 void sleepSeconds(uint32_t seconds)
 {
-	unsigned long i, j;
-
 	stay_asleep = true;
-	for(i=0; i<seconds && stay_asleep; i++) {
-		for(j=0; j<1000 && stay_asleep; j++) {
-			delayMicroseconds(1000);
-		}
-	}
+	waitCycles(cycles64() + (uint64_t) seconds * F_CPU, true);
 	stay_asleep = false;
 }
 
 void suspend(void)
 {
 	stay_asleep = true;
+	waitCycles(0xFFFFFFFFFFFFFFFFULL, true);
+}
 
-	while(stay_asleep)
-		;
+/*
+ * Tickless sleep: waits for any interrupt, for up to 'ms' milliseconds.
+ * The Timer5 period is stretched to 'ms' so the millisecond tick does not
+ * wake the CPU, and the elapsed time is added to milliseconds on wakeup.
+ * Must be called with interrupts disabled, and returns with them disabled:
+ * the interrupt that caused the wakeup runs when they are enabled again.
+ */
+void timerSleep(uint32_t ms)
+{
+	unsigned long period = F_CPU / 1000;
+	unsigned long elapsed, tav, tavStart, cyclesStart;
+
+	if (ms > softTimerNext(milliseconds))
+		ms = softTimerNext(milliseconds);
+	if (mt_next_tick && ms > mt_next_tick(milliseconds))
+		ms = mt_next_tick(milliseconds);
+	if (ms > 0xFFFFFFFF / period - 1)
+		ms = 0xFFFFFFFF / period - 1;
+	if (ms < 2) {
+		/* the next tick is close enough */
+		CPUwfi();
+		return;
+	}
+
+	if (HWREG(TIMER5_BASE + TIMER_O_RIS) & TIMER_RIS_TATORIS) {
+		/* a tick is already pending: WFI would return at once and the
+		 * whole sleep be counted. Count that tick only */
+		ROM_TimerIntClear(TIMER5_BASE, TIMER_TIMA_TIMEOUT);
+		milliseconds++;
+		cycles64();
+		if (mt_tick)
+			mt_tick(milliseconds);
+		softTimerRun(milliseconds);
+		return;
+	}
+
+	cycles64();
+	cyclesStart = HWREG(DWT_CYCCNT);
+	tavStart = HWREG(TIMER5_BASE + TIMER_O_TAV);
+	ROM_TimerLoadSet(TIMER5_BASE, TIMER_A, ms * period);
+	CPUwfi();
+
+	tav = HWREG(TIMER5_BASE + TIMER_O_TAV);
+	if (HWREG(TIMER5_BASE + TIMER_O_RIS) & TIMER_RIS_TATORIS) {
+		/* the whole period elapsed: TAV restarted from 0, read it again
+		 * in case it wrapped after the first read */
+		tav = HWREG(TIMER5_BASE + TIMER_O_TAV);
+		ROM_TimerIntClear(TIMER5_BASE, TIMER_TIMA_TIMEOUT);
+		elapsed = ms;
+	} else {
+		elapsed = 0;
+	}
+
+	/* Timer5 counts the system clock during the sleep, the DWT may not:
+	 * add the difference to cycles64() */
+	cycles64();
+	cyclesOffset += (uint32_t)(elapsed * period + tav - tavStart);
+	cyclesOffset -= (uint32_t)(HWREG(DWT_CYCCNT) - cyclesStart);
+
+	elapsed += tav / period;
+
+	/* keep the phase inside the current millisecond */
+	HWREG(TIMER5_BASE + TIMER_O_TAV) = tav % period;
+	ROM_TimerLoadSet(TIMER5_BASE, TIMER_A, period);
+
+	milliseconds += elapsed;
+	if (mt_tick)
+		mt_tick(milliseconds);
+	softTimerRun(milliseconds);
 }
 
 void Timer5IntHandler(void)
 {
-
+	TRACE_ISR_ENTER();
     ROM_TimerIntClear(TIMER5_BASE, TIMER_TIMA_TIMEOUT);
 	milliseconds++;
+	if (!(milliseconds & 0x3FF))
+		cycles64();	/* counts the CYCCNT wraps */
+	if (mt_tick)
+		mt_tick(milliseconds);
+	softTimerRun(milliseconds);
+	TRACE_ISR_EXIT();
 }
 
+/*
+ * Deprecated: calls 'userFunc' every SYSTICKMS milliseconds with the
+ * elapsed time. Kept for compatibility, new code uses softTimerStart().
+ */
 void registerSysTickCb(void (*userFunc)(uint32_t))
 {
+	static softTimer_t sysTickTimers[8];
 	uint8_t i;
 	for (i=0; i<8; i++) {
-		if(!SysTickCbFuncs[i]) {
-			SysTickCbFuncs[i] = userFunc;
+		if(!softTimerActive(&sysTickTimers[i])) {
+			softTimerInit(&sysTickTimers[i], userFunc, SYSTICKMS);
+			softTimerStart(&sysTickTimers[i], SYSTICKMS, SYSTICKMS);
 			break;
 		}
 	}
@@ -168,9 +358,5 @@ void registerSysTickCb(void (*userFunc)(uint32_t))
 
 void SysTickIntHandler(void)
 {
-	uint8_t i;
-	for (i=0; i<8; i++) {
-		if (SysTickCbFuncs[i])
-			SysTickCbFuncs[i](SYSTICKMS);
-	}
+	/* the SysTick interrupt is disabled */
 }
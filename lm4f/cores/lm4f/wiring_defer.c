@@ -0,0 +1,109 @@
+/*
+ ************************************************************************
+ *	wiring_defer.c
+ *
+ *	Energia core files for LM4F
+ *
+ *
+ ***********************************************************************
+  Deferred interrupt work.
+
+  Interrupt handlers post the slow part of their processing as a work
+  item, which runs later at thread level: in the worker task of the
+  Multitask library when one is registered, otherwise after each loop().
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+ */
+
+#include <stdint.h>
+
+#define DEFERRED_QUEUE_SIZE 32	/* must be a power of 2 */
+
+/* An item is published by writing its work function last, and released
+ * by clearing it before the slot is given back to the producers. */
+typedef struct {
+	void (* volatile work)(uint32_t);
+	uint32_t arg;
+} deferredItem_t;
+
+static deferredItem_t deferredQueue[DEFERRED_QUEUE_SIZE];
+static volatile uint32_t deferredHead = 0;	/* next slot to reserve */
+static volatile uint32_t deferredTail = 0;	/* next slot to run */
+static void (* volatile deferredWake)(void) = 0;
+
+/* Posts work(arg) to run at thread level. Lock-free: it can be called
+ * from any interrupt handler, at any priority, and from tasks.
+ * Returns 0 if the queue is full. */
+int deferWork(void (*work)(uint32_t), uint32_t arg)
+{
+	uint32_t head;
+	deferredItem_t *item;
+
+	if (!work)
+		return 0;
+
+	/* reserve a slot */
+	do {
+		head = deferredHead;
+		if (head - deferredTail >= DEFERRED_QUEUE_SIZE)
+			return 0;
+	} while (!__sync_bool_compare_and_swap(&deferredHead, head, head + 1));
+
+	item = &deferredQueue[head & (DEFERRED_QUEUE_SIZE - 1)];
+	item->arg = arg;
+	__sync_synchronize();
+	item->work = work;
+
+	if (deferredWake)
+		deferredWake();
+	return 1;
+}
+
+/* Runs the posted work items, in order. Only one caller at a time:
+ * the worker task, or the main loop when there is none. */
+void runDeferredWork(void)
+{
+	deferredItem_t *item;
+	void (*work)(uint32_t);
+	uint32_t arg;
+
+	for (;;) {
+		item = &deferredQueue[deferredTail & (DEFERRED_QUEUE_SIZE - 1)];
+		work = item->work;
+		if (!work)
+			break;	/* empty, or the next item is still being posted */
+		arg = item->arg;
+		item->work = 0;
+		__sync_synchronize();
+		deferredTail++;
+		work(arg);
+	}
+}
+
+/* Registers the function that wakes the worker task when work is posted,
+ * or 0 when the worker stops. */
+void registerDeferredWorker(void (*wake)(void))
+{
+	deferredWake = wake;
+}
+
+/* Returns true while a worker task runs the deferred work. The drivers
+ * only defer their processing then: the main loop can be kept busy by the
+ * sketch for too long. */
+int hasDeferredWorker(void)
+{
+	return deferredWake != 0;
+}
@@ -0,0 +1,62 @@
+/*
+ ************************************************************************
+ *	wiring_format.h
+ *
+ *	Energia core files
+ *
+ *
+ ***********************************************************************
+  Number formatting used by Print, shared by the cores.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#ifndef wiring_format_h
+#define wiring_format_h
+
+#include <limits.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FORMAT_ULONG_SIZE     (CHAR_BIT * sizeof(long))  /* digits of a long in base 2 */
+#define FORMAT_MAX_DECIMALS   9     /* decimals computed by format_double() */
+#define FORMAT_FLOAT_SIZE     24    /* sign, 10 digits, point, decimals */
+#define FORMAT_DOUBLE_MAX     4294967040.0  /* largest integer part, as a float */
+
+/*
+ * Writes the digits of 'n' in 'base' backwards, the last one just before
+ * 'end'. Returns the first digit. There must be room for FORMAT_ULONG_SIZE
+ * characters before 'end'. A base below 2 is taken as 10.
+ */
+char *format_ulong(char *end, unsigned long n, unsigned char base);
+
+/*
+ * Writes 'number' rounded to 'digits' decimals (at most
+ * FORMAT_MAX_DECIMALS) to 'buf', of FORMAT_FLOAT_SIZE characters, without
+ * a terminating zero. Numbers beyond +/-FORMAT_DOUBLE_MAX are written as "ovf",
+ * NaN as "nan" and the infinities as "inf".
+ * Returns the number of characters written.
+ */
+int format_double(char *buf, double number, unsigned char digits);
+int format_float(char *buf, float number, unsigned char digits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
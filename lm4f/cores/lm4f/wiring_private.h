@@ -45,6 +45,15 @@ uint8_t getTimerInterrupt(uint8_t timer);
 uint32_t getTimerBase(uint32_t offset);
 void ToneIntHandler(void);
 void GPIOIntHandler(void);
+void softTimerRun(uint32_t now);
+uint32_t softTimerNext(uint32_t now);
+void udmaInit(void);
+
+/* DWT cycle counter, enabled by timerInit() */
+#define DEMCR_TRCENA            0x01000000	/* enables the DWT */
+#define DWT_CTRL                (DWT_BASE + 0x000)
+#define DWT_CYCCNT              (DWT_BASE + 0x004)
+#define DWT_CTRL_CYCCNTENA      0x00000001
 
 typedef void (*voidFuncPtr)(void);
 
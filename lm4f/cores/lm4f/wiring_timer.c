@@ -0,0 +1,201 @@
+/*
+ ************************************************************************
+ *	wiring_timer.c
+ *
+ *	Energia core files for LM4F
+ *
+ *
+ ***********************************************************************
+  Software timers.
+
+  One-shot and periodic timers with millisecond resolution, driven by the
+  Timer5 millisecond tick. The armed timers are kept in a binary min-heap
+  ordered by expiry time: starting or stopping a timer is O(log n), and a
+  tick with no timer due costs one comparison.
+
+  The callbacks run in the Timer5 interrupt handler: slow processing should
+  be posted with deferWork().
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+ */
+
+#include "Energia.h"
+#include "wiring_private.h"
+#include "driverlib/rom.h"
+
+#ifndef SOFT_TIMER_MAX
+#define SOFT_TIMER_MAX	32	/* timers armed at the same time */
+#endif
+
+static softTimer_t *timerHeap[SOFT_TIMER_MAX];
+static volatile uint32_t timerCount = 0;
+
+static int timerBefore(softTimer_t *a, softTimer_t *b)
+{
+	return (int32_t)(a->expires - b->expires) < 0;
+}
+
+static void timerPlace(uint32_t i, softTimer_t *timer)
+{
+	timerHeap[i] = timer;
+	timer->slot = i + 1;
+}
+
+static void timerSiftUp(uint32_t i)
+{
+	softTimer_t *timer = timerHeap[i];
+
+	while (i > 0) {
+		uint32_t parent = (i - 1) / 2;
+		if (!timerBefore(timer, timerHeap[parent]))
+			break;
+		timerPlace(i, timerHeap[parent]);
+		i = parent;
+	}
+	timerPlace(i, timer);
+}
+
+static void timerSiftDown(uint32_t i)
+{
+	softTimer_t *timer = timerHeap[i];
+
+	for (;;) {
+		uint32_t child = 2 * i + 1;
+		if (child >= timerCount)
+			break;
+		if (child + 1 < timerCount && timerBefore(timerHeap[child + 1], timerHeap[child]))
+			child++;
+		if (!timerBefore(timerHeap[child], timer))
+			break;
+		timerPlace(i, timerHeap[child]);
+		i = child;
+	}
+	timerPlace(i, timer);
+}
+
+static void timerRemove(softTimer_t *timer)
+{
+	uint32_t i = timer->slot - 1;
+	softTimer_t *last = timerHeap[--timerCount];
+
+	timer->slot = 0;
+	if (last == timer)
+		return;
+	timerPlace(i, last);
+	timerSiftUp(i);
+	timerSiftDown(last->slot - 1);
+}
+
+/* Sets the function called when 'timer' expires, with 'arg'.
+ * A timer must not be initialized while it is running. */
+void softTimerInit(softTimer_t *timer, void (*callback)(uint32_t), uint32_t arg)
+{
+	timer->callback = callback;
+	timer->arg = arg;
+	timer->slot = 0;
+}
+
+/* Starts 'timer': it expires in 'ms' milliseconds, then every 'period'
+ * milliseconds, or only once if 'period' is 0. A running timer is
+ * restarted. Can be called from interrupt handlers and timer callbacks.
+ * Returns 0 if SOFT_TIMER_MAX timers are already running. */
+int softTimerStart(softTimer_t *timer, uint32_t ms, uint32_t period)
+{
+	uint32_t oldLevel = ROM_IntMasterDisable();
+	int ret = 1;
+
+	if (timer->slot)
+		timerRemove(timer);
+	if (timerCount < SOFT_TIMER_MAX) {
+		timer->expires = millis() + ms;
+		timer->period = period;
+		timerPlace(timerCount++, timer);
+		timerSiftUp(timer->slot - 1);
+	} else {
+		ret = 0;
+	}
+	if (!oldLevel)
+		ROM_IntMasterEnable();
+	return ret;
+}
+
+/* Stops 'timer' if it is running. */
+void softTimerStop(softTimer_t *timer)
+{
+	uint32_t oldLevel = ROM_IntMasterDisable();
+
+	if (timer->slot)
+		timerRemove(timer);
+	if (!oldLevel)
+		ROM_IntMasterEnable();
+}
+
+/* Returns 1 if 'timer' is running. */
+int softTimerActive(softTimer_t *timer)
+{
+	return timer->slot != 0;
+}
+
+/* Runs the callbacks of the timers expired at 'now' (milliseconds).
+ * Called from the Timer5 interrupt handler. A periodic timer late by more
+ * than its period, after a tickless sleep, runs once and keeps its
+ * period from 'now'. */
+void softTimerRun(uint32_t now)
+{
+	while (timerCount) {
+		uint32_t oldLevel = ROM_IntMasterDisable();
+		softTimer_t *timer = timerHeap[0];
+		void (*callback)(uint32_t);
+		uint32_t arg;
+
+		if (!timerCount || (int32_t)(now - timer->expires) < 0) {
+			if (!oldLevel)
+				ROM_IntMasterEnable();
+			break;
+		}
+		callback = timer->callback;
+		arg = timer->arg;
+		if (timer->period) {
+			timer->expires += timer->period;
+			if ((int32_t)(now - timer->expires) >= 0)
+				timer->expires = now + timer->period;
+			timerSiftDown(0);
+		} else {
+			timerRemove(timer);
+		}
+		if (!oldLevel)
+			ROM_IntMasterEnable();
+		/* the callback can restart or stop its timer */
+		if (callback)
+			callback(arg);
+	}
+}
+
+/* Returns the milliseconds from 'now' to the next timer expiry, 0 if
+ * one is due, or 0xFFFFFFFF if no timer runs. */
+uint32_t softTimerNext(uint32_t now)
+{
+	uint32_t oldLevel = ROM_IntMasterDisable();
+	uint32_t ms = 0xFFFFFFFF;
+
+	if (timerCount) {
+		int32_t left = (int32_t)(timerHeap[0]->expires - now);
+		ms = left > 0 ? left : 0;
+	}
+	if (!oldLevel)
+		ROM_IntMasterEnable();
+	return ms;
+}
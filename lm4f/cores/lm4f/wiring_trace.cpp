@@ -0,0 +1,142 @@
+/*
+ ************************************************************************
+ *	wiring_trace.cpp
+ *
+ *	Energia core files for LM4F
+ *
+ *
+ ***********************************************************************
+  Event trace buffer.
+
+  The schedulers and the core interrupt handlers record their events in
+  a ring buffer in RAM, timestamped with the DWT cycle counter. When the
+  trace is stopped, traceDump() prints it as text, which
+  tools/trace2json.py converts to the Chrome trace format (chrome://tracing
+  or ui.perfetto.dev).
+
+  While the trace is not started, each trace point costs a load and a
+  branch (see TRACE() in Energia.h).
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+ */
+
+#include <stdlib.h>
+#include "Energia.h"
+#include "wiring_private.h"
+#include "inc/hw_memmap.h"
+
+typedef struct {
+	uint32_t time;		/* DWT cycle count */
+	uint16_t event;
+	uint16_t arg;
+} traceEntry_t;
+
+volatile uint8_t traceEnabled = 0;
+
+static traceEntry_t *traceBuffer = 0;
+static uint32_t traceMask = 0;			/* entries - 1 */
+static volatile uint32_t traceHead = 0;	/* entries recorded since traceStart() */
+
+/* Allocates a buffer of 'entries' events (8 bytes each), rounded down to
+ * a power of 2, and starts the trace. The oldest events are overwritten
+ * when the buffer is full.
+ * Returns 0 if the buffer can not be allocated. */
+int traceBegin(uint16_t entries)
+{
+	uint32_t size = 1;
+
+	traceEnabled = 0;
+	while (size * 2 <= entries)
+		size *= 2;
+	if (traceBuffer)
+		free(traceBuffer);
+	traceBuffer = (traceEntry_t *) malloc(size * sizeof(traceEntry_t));
+	if (!traceBuffer)
+		return 0;
+	traceMask = size - 1;
+	traceStart();
+	return 1;
+}
+
+/* Clears the buffer and starts recording. */
+void traceStart(void)
+{
+	if (!traceBuffer)
+		return;
+	traceHead = 0;
+	traceEnabled = 1;
+}
+
+/* Stops recording, the buffer is kept for traceDump(). */
+void traceStop(void)
+{
+	traceEnabled = 0;
+}
+
+/* Records an event. Lock-free: it can be called from any interrupt
+ * handler, at any priority, and from tasks. The timestamp is read before
+ * the slot is reserved, so the events of an interrupt that preempts this
+ * function can be stored first: the converter sorts them by time. */
+void traceEvent(uint16_t event, uint16_t arg)
+{
+	uint32_t time = HWREG(DWT_CYCCNT);
+	traceEntry_t *entry;
+
+	if (!traceEnabled)
+		return;
+	entry = &traceBuffer[__sync_fetch_and_add(&traceHead, 1) & traceMask];
+	entry->time = time;
+	entry->event = event;
+	entry->arg = arg;
+}
+
+static void tracePrintHex(Print &out, uint32_t value, int digits)
+{
+	while (digits--)
+		out.print("0123456789abcdef"[(value >> (4 * digits)) & 0xF]);
+}
+
+/* Stops the trace and prints it, oldest event first:
+ *   TRACE <cycles per second> <events>
+ *   <cycle count> <event> <arg>     (hexadecimal, one line per event)
+ *   END */
+void traceDump(Print &out)
+{
+	uint32_t count, first, i;
+
+	traceStop();
+	count = traceHead;
+	if (!traceBuffer)
+		count = 0;
+	else if (count > traceMask + 1)
+		count = traceMask + 1;
+	first = traceHead - count;
+
+	out.print("TRACE ");
+	out.print(F_CPU);
+	out.print(' ');
+	out.println(count);
+	for (i = 0; i < count; i++) {
+		traceEntry_t *entry = &traceBuffer[(first + i) & traceMask];
+		tracePrintHex(out, entry->time, 8);
+		out.print(' ');
+		tracePrintHex(out, entry->event, 4);
+		out.print(' ');
+		tracePrintHex(out, entry->arg, 4);
+		out.println();
+	}
+	out.println("END");
+}
@@ -0,0 +1,49 @@
+/*
+ ************************************************************************
+ *	wiring_udma.c
+ *
+ *	Energia core files for LM4F
+ *
+ *
+ ***********************************************************************
+  uDMA controller.
+
+  The channel control table is shared by all the drivers that use the
+  uDMA: each driver assigns and configures its own channels.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+ */
+
+#include "Energia.h"
+#include "wiring_private.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/udma.h"
+
+/* primary and alternate structures of the 32 channels */
+static tDMAControlTable udmaControlTable[64] __attribute__((aligned(1024)));
+static uint8_t udmaEnabled = 0;
+
+/* Enables the uDMA controller, once. */
+void udmaInit(void)
+{
+	if (udmaEnabled)
+		return;
+	MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+	MAP_uDMAEnable();
+	MAP_uDMAControlBaseSet(udmaControlTable);
+	udmaEnabled = 1;
+}
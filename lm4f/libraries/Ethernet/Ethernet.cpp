@@ -4,14 +4,20 @@
 #include <lwip/inet.h>
 #include <IPAddress.h>
 
-#define ETHERNET_INT_PRIORITY   0xC0
+#define LWIP_TIMER_MS           10
+
+static softTimer_t lwIPTimerTick;
 
 void EthernetClass::begin(uint8_t *mac_address, IPAddress local_ip, IPAddress dns_server, IPAddress gateway, IPAddress subnet)
 {
 	uint32_t ui32User0, ui32User1;
 	uint8_t pui8MACArray[8];
 
-	registerSysTickCb(lwIPTimer);
+	/* a repeated begin() keeps the running timer */
+	if (!softTimerActive(&lwIPTimerTick)) {
+		softTimerInit(&lwIPTimerTick, lwIPTimer, LWIP_TIMER_MS);
+		softTimerStart(&lwIPTimerTick, LWIP_TIMER_MS, LWIP_TIMER_MS);
+	}
 	ROM_FlashUserGet(&ui32User0, &ui32User1);
 
 	/*
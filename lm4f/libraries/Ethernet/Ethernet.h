@@ -9,6 +9,11 @@
 #include "EthernetClient.h"
 #include "EthernetServer.h"
 
+/* the Ethernet interrupt wakes the tasks reading the clients */
+#if defined(MT_KERNEL_PRIORITY) && MT_KERNEL_PRIORITY && MT_KERNEL_PRIORITY > ETHERNET_INT_PRIORITY
+#error "MT_KERNEL_PRIORITY must not be lower than ETHERNET_INT_PRIORITY (a higher value)"
+#endif
+
 #define CLASS_A 0x0
 #define CLASS_B 0x2
 #define CLASS_C 0x6
@@ -6,11 +6,6 @@
 
 #include "driverlib/interrupt.h"
 
-/* directives for disabling and enabling interrupts */
-#define INT_PROTECT_INIT(x)    int x = 0
-#define INT_PROTECT(x)         x=IntMasterDisable()
-#define INT_UNPROTECT(x)       do{if(!x)IntMasterEnable();}while(0)
-
 /* SYNC_FETCH_AND_NULL: atomic{ tmp=*x; *x=NULL; return tmp; } */
 #define SYNC_FETCH_AND_NULL(x)   (__sync_fetch_and_and(x, NULL))
 
@@ -20,6 +15,7 @@ EthernetClient::EthernetClient() {
 	cs->mode = true;
 	cs->cpcb = NULL;
 	cs->p = NULL;
+	cs->readers = 0;
 }
 
 EthernetClient::EthernetClient(struct client *c) {
@@ -28,6 +24,7 @@ EthernetClient::EthernetClient(struct client *c) {
 		cs = &client_state;
 		cs->cpcb = NULL;
 		cs->p = NULL;
+		cs->readers = 0;
 		return;
 	}
 	_connected = true;
@@ -79,6 +76,7 @@ void EthernetClient::do_err(void * arg, err_t err) {
 
 	if (client->_connected) {
 		client->_connected = false;
+		notifyReaders(&client->cs->readers);
 		return;
 	}
 
@@ -110,6 +108,7 @@ err_t EthernetClient::do_recv(void *arg, struct tcp_pcb *cpcb, struct pbuf *p,
 	/* p==0 for end-of-connection (TCP_FIN packet) */
 	if (p == 0) {
 		client->_connected = false;
+		notifyReaders(&client->cs->readers);
 		return ERR_OK;
 	}
 
@@ -118,6 +117,9 @@ err_t EthernetClient::do_recv(void *arg, struct tcp_pcb *cpcb, struct pbuf *p,
 	else
 		client->cs->p = p;
 
+	/* wake the tasks waiting for data */
+	notifyReaders(&client->cs->readers);
+
 	return ERR_OK;
 }
 
@@ -207,7 +209,12 @@ size_t EthernetClient::write(const uint8_t *buf, size_t size) {
 	// Attempt to write in 1024-byte increments.
 	while (i < size) {
 		inc = (size - i) < 1024 ? size - i : 1024;
-		err_t err = tcp_write(cpcb, buf + i, inc, TCP_WRITE_FLAG_COPY);
+		err_t err;
+		{
+			// lwIP also runs in the Ethernet interrupt or worker task
+			CriticalSection lock(ETHERNET_INT_PRIORITY);
+			err = tcp_write(cpcb, buf + i, inc, TCP_WRITE_FLAG_COPY);
+		}
 		if (err != ERR_MEM) {
 			// Keep enqueueing the lwIP buffer until it's full...
 			i += inc;
@@ -215,8 +222,10 @@ size_t EthernetClient::write(const uint8_t *buf, size_t size) {
 		} else {
 			if (!stuffed_buffer) {
 				// Buffer full; force output
-				if (cs->mode)
+				if (cs->mode) {
+					CriticalSection lock(ETHERNET_INT_PRIORITY);
 					tcp_output(cpcb);
+				}
 				stuffed_buffer = true;
 			} else {
 				delay(1); // else wait a little bit for lwIP to flush its buffers
@@ -225,8 +234,10 @@ size_t EthernetClient::write(const uint8_t *buf, size_t size) {
 	}
 	// flush any remaining queue contents
 	if (!stuffed_buffer) {
-		if (cs->mode)
+		if (cs->mode) {
+			CriticalSection lock(ETHERNET_INT_PRIORITY);
 			tcp_output(cpcb);
+		}
 	}
 
 	return size;
@@ -239,25 +250,27 @@ int EthernetClient::available() {
 	return p->tot_len - cs->read;
 }
 
+/*
+ * The wait list is kept in the connection state, shared by the
+ * EthernetClient objects returned by EthernetServer::available().
+ */
+volatile unsigned int *EthernetClient::readers() {
+	return &cs->readers;
+}
+
 int EthernetClient::port() {
 	return cs->port;
 }
 
 int EthernetClient::readLocked() {
-	INT_PROTECT_INIT(oldLevel);
-
 	/* protect the code from preemption of the ethernet interrupt servicing */
-	INT_PROTECT(oldLevel);
+	CriticalSection lock(ETHERNET_INT_PRIORITY);
 
-	if (!available()) {
-		INT_UNPROTECT(oldLevel);
+	if (!available())
 		return -1;
-	}
 
-	if (!cs->cpcb) {
-		INT_UNPROTECT(oldLevel);
+	if (!cs->cpcb)
 		return -1;
-	}
 
 	uint8_t *buf = (uint8_t *) cs->p->payload;
 	uint8_t b = buf[cs->read];
@@ -282,8 +295,6 @@ int EthernetClient::readLocked() {
 		cs->p = NULL;
 	}
 
-	INT_UNPROTECT(oldLevel);
-
 	return b;
 }
 
@@ -292,62 +303,105 @@ int EthernetClient::read() {
 }
 
 int EthernetClient::read(uint8_t *buf, size_t size) {
-	uint16_t i;
-	int b;
+	size_t count = 0;
+	const uint8_t *ptr;
 
 	if (available() <= 0)
 		return -1;
 
-	/* TODO: Replace lazy method with optimized on */
-	for (i = 0; i < size; i++) {
-		b = read();
-		if (b == -1)
+	/* copy one pbuf of the chain at a time */
+	while (count < size) {
+		size_t len = peekSpan(ptr);
+		if (!len)
 			break;
-		buf[i] = b;
+		if (len > size - count)
+			len = size - count;
+		memcpy(buf + count, ptr, len);
+		consume(len);
+		count += len;
 	}
 
-	return i;
+	return count;
 }
 
-int EthernetClient::peek() {
-	INT_PROTECT_INIT(oldLevel);
-	uint8_t b;
-
+/*
+ * Points 'ptr' at the unread data of the first pbuf of the chain.
+ */
+size_t EthernetClient::peekSpan(const uint8_t *&ptr) {
 	/* protect code from preemption of the ethernet interrupt servicing */
-	INT_PROTECT(oldLevel);
+	CriticalSection lock(ETHERNET_INT_PRIORITY);
 
-	if (!available()) {
-		INT_UNPROTECT(oldLevel);
-		return -1;
+	ptr = NULL;
+	if (available() <= 0 || !cs->cpcb)
+		return 0;
+
+	ptr = (const uint8_t *) cs->p->payload + cs->read;
+	return cs->p->len - cs->read;
+}
+
+/*
+ * Drops 'n' bytes of the received data, releasing the pbufs read and
+ * opening the TCP window by 'n'.
+ */
+void EthernetClient::consume(size_t n) {
+	/* protect the code from preemption of the ethernet interrupt servicing */
+	CriticalSection lock(ETHERNET_INT_PRIORITY);
+
+	int left = available();
+	if (left <= 0 || !cs->cpcb)
+		return;
+	if (n > (size_t) left)
+		n = left;
+
+	tcp_recved((tcp_pcb*)cs->cpcb, n);
+
+	while (n) {
+		struct pbuf * p = (pbuf*)cs->p;
+		size_t len = p->len - cs->read;
+		if (n < len) {
+			cs->read += n;
+			break;
+		}
+		n -= len;
+		cs->read = 0;
+		if (p->next) {
+			cs->p = p->next;
+			/* keep p->next when p is freed */
+			pbuf_ref((pbuf*)cs->p);
+			pbuf_free(p);
+		} else {
+			pbuf_free(p);
+			cs->p = NULL;
+		}
 	}
+}
 
-	uint8_t *buf = (uint8_t *) cs->p->payload;
-	b = buf[cs->read];
+int EthernetClient::peek() {
+	/* protect code from preemption of the ethernet interrupt servicing */
+	CriticalSection lock(ETHERNET_INT_PRIORITY);
 
-	INT_UNPROTECT(oldLevel);
+	if (!available())
+		return -1;
 
-	return b;
+	uint8_t *buf = (uint8_t *) cs->p->payload;
+	return buf[cs->read];
 }
 
 void EthernetClient::flush() {
-	INT_PROTECT_INIT(oldLevel);
 	/* protect code from preemption of the ethernet interrupt servicing */
-	INT_PROTECT(oldLevel);
+	CriticalSection lock(ETHERNET_INT_PRIORITY);
 	if (available()) {
 		cs->read = cs->p->tot_len;
 		tcp_recved((tcp_pcb*)cs->cpcb, 0);
 	}
-	INT_UNPROTECT(oldLevel);
 }
 
 void EthernetClient::stop() {
 	/* Stop frees any resources including any unread buffers */
 	err_t err;
 
-	INT_PROTECT_INIT(oldLevel);
-
 	/* protect the code from preemption of the ethernet interrupt servicing */
-	INT_PROTECT(oldLevel);
+	CriticalSection lock(ETHERNET_INT_PRIORITY);
 
 	struct tcp_pcb * cpcb_copy = (tcp_pcb *) SYNC_FETCH_AND_NULL(&cs->cpcb);
 	struct pbuf * p_copy = (pbuf *) SYNC_FETCH_AND_NULL(&cs->p);
@@ -369,8 +423,6 @@ void EthernetClient::stop() {
 			tcp_poll(cpcb_copy, do_poll, 4);
 		}
 	}
-
-	INT_UNPROTECT(oldLevel);
 }
 
 uint8_t EthernetClient::connected() {
@@ -25,10 +25,13 @@ public:
 	virtual int port();
 	virtual int read(uint8_t *buf, size_t size);
 	virtual int peek();
+	virtual size_t peekSpan(const uint8_t *&ptr);
+	virtual void consume(size_t n);
 	virtual void flush();
 	virtual void stop();
 	virtual uint8_t connected();
 	virtual operator bool();
+	virtual volatile unsigned int *readers();
 	static err_t do_connected(void *arg, struct tcp_pcb *pcb, err_t err);
 	static err_t do_recv(void *arg, struct tcp_pcb *cpcb, struct pbuf *p, err_t err);
 	static err_t do_poll(void *arg, struct tcp_pcb *cpcb);
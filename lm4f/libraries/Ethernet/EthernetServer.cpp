@@ -68,6 +68,9 @@ void EthernetServer::do_close(void *arg, struct tcp_pcb *cpcb) {
 		cs->cpcb = NULL;
 	}
 
+	/* wake the tasks waiting for data: the connection is closed */
+	EthernetClient::notifyReaders(&cs->readers);
+
 	return;
 }
 
@@ -106,6 +109,9 @@ err_t EthernetServer::do_recv(void *arg, struct tcp_pcb *cpcb, struct pbuf *p,
 	else
 		server->clients[i].p = p;
 
+	/* wake the tasks waiting for data */
+	EthernetClient::notifyReaders(&server->clients[i].readers);
+
 	return ERR_OK;
 }
 
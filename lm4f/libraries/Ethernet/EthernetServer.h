@@ -20,6 +20,8 @@ struct client {
 	volatile bool connected;
 	uint16_t read;
 	bool mode;
+	/* Tasks blocked in waitReadable() on the connection. */
+	volatile unsigned int readers;
 };
 
 class EthernetClient;
@@ -78,6 +78,15 @@ extern "C"
 #define IPADDR_USE_DHCP         1
 #define IPADDR_USE_AUTOIP       2
 
+//*****************************************************************************
+//
+// Priority of the Ethernet interrupt, which runs lwIP.  The client methods
+// mask it with CriticalSection, and the lwIP work deferred to the Multitask
+// worker task runs with it masked, so that lwIP is never re-entered.
+//
+//*****************************************************************************
+#define ETHERNET_INT_PRIORITY   0xC0
+
 //*****************************************************************************
 //
 // Hardware timer interrupt callback function type (available only when running
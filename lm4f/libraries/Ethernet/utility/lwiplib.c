@@ -849,6 +849,75 @@ lwIPTimer(uint32_t ui32TimeMS)
 }
 #endif
 
+//*****************************************************************************
+//
+// Ethernet work deferred to the worker task of the Multitask library.  The
+// interrupt handler accumulates the interrupt status, disables the Ethernet
+// interrupts and posts lwIPDeferredWork(), which runs the lwIP processing at
+// thread level.  The busy flag stays set until the work is done, so lwIP is
+// never entered from the interrupt handler meanwhile.
+//
+//*****************************************************************************
+#if NO_SYS
+#define EMAC_INT_DEFERRED       (EMAC_INT_RECEIVE | EMAC_INT_TRANSMIT |       \
+                                 EMAC_INT_TX_STOPPED |                        \
+                                 EMAC_INT_RX_NO_BUFFER |                      \
+                                 EMAC_INT_RX_STOPPED | EMAC_INT_PHY)
+
+static volatile uint32_t g_ui32DeferredStatus = 0;
+static volatile bool g_bDeferredRun = false;
+static volatile bool g_bDeferredBusy = false;
+
+static void
+lwIPDeferredWork(uint32_t ui32Unused)
+{
+    uint32_t ui32Status;
+    uint32_t ui32Level;
+    bool bIntDisabled;
+
+    while(1)
+    {
+        //
+        // Take the interrupt status accumulated by the interrupt handler.
+        //
+        bIntDisabled = MAP_IntMasterDisable();
+        ui32Status = g_ui32DeferredStatus;
+        g_ui32DeferredStatus = 0;
+        if(!g_bDeferredRun)
+        {
+            //
+            // Done: give the processing back to the interrupt handler.
+            //
+            g_bDeferredBusy = false;
+            MAP_EMACIntEnable(EMAC0_BASE, EMAC_INT_DEFERRED);
+            if(!bIntDisabled)
+            {
+                MAP_IntMasterEnable();
+            }
+            return;
+        }
+        g_bDeferredRun = false;
+        if(!bIntDisabled)
+        {
+            MAP_IntMasterEnable();
+        }
+
+        //
+        // A task that preempts the worker enters lwIP from the Ethernet
+        // client methods with the Ethernet interrupt masked: masking it
+        // here too, which also holds off PendSV, serializes them.
+        //
+        ui32Level = criticalEnter(ETHERNET_INT_PRIORITY);
+        if(ui32Status)
+        {
+            tivaif_interrupt(&g_sNetIF, ui32Status);
+        }
+        lwIPServiceTimers();
+        criticalExit(ETHERNET_INT_PRIORITY, ui32Level);
+    }
+}
+#endif
+
 //*****************************************************************************
 //
 //! Handles Ethernet interrupts for the lwIP TCP/IP stack.
@@ -874,6 +943,8 @@ lwIPEthernetIntHandler(void)
     portBASE_TYPE xWake;
 #endif
 
+    TRACE_ISR_ENTER();
+
     //
     // Read and Clear the interrupt.
     //
@@ -911,6 +982,34 @@ lwIPEthernetIntHandler(void)
     // The handling of the interrupt is different based on the use of a RTOS.
     //
 #if NO_SYS
+    //
+    // With a worker task, or while deferred work is pending, leave the lwIP
+    // processing to the worker.  If the work can not be posted, the next
+    // lwIPTimer() interrupt retries.
+    //
+    if(g_bDeferredBusy || hasDeferredWorker())
+    {
+        g_ui32DeferredStatus |= ui32Status;
+        g_bDeferredRun = true;
+        MAP_EMACIntDisable(EMAC0_BASE, EMAC_INT_DEFERRED);
+        if(!g_bDeferredBusy)
+        {
+            g_bDeferredBusy = deferWork(lwIPDeferredWork, 0);
+        }
+        TRACE_ISR_EXIT();
+        return;
+    }
+    if(g_bDeferredRun)
+    {
+        //
+        // The worker stopped before the work could be posted.
+        //
+        ui32Status |= g_ui32DeferredStatus;
+        g_ui32DeferredStatus = 0;
+        g_bDeferredRun = false;
+        MAP_EMACIntEnable(EMAC0_BASE, EMAC_INT_DEFERRED);
+    }
+
     //
     // No RTOS is being used.  If a transmit/receive interrupt was active,
     // run the low-level interrupt handler.
@@ -950,6 +1049,8 @@ lwIPEthernetIntHandler(void)
     }
 #endif
 #endif
+
+    TRACE_ISR_EXIT();
 }
 
 //*****************************************************************************
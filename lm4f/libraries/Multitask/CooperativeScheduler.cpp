@@ -32,6 +32,17 @@
 #include "driverlib/sysctl.h"
 #include "driverlib/timer.h"
 #include "utility/CooperativeScheduler.h"
+#include "utility/StackPool.h"
+#include "utility/SchedulerOps.h"
+#include "utility/TaskStats.h"
+
+#elif defined(__x86_64__)
+
+#include "HostPort.h"
+#include "CooperativeScheduler.h"
+#include "StackPool.h"
+#include "SchedulerOps.h"
+#include "TaskStats.h"
 
 #else
 
@@ -48,6 +59,8 @@ cmt_data_t * cmt_data = NULL;
 unsigned int cmt_is_eh() {
 #ifdef __ARM_ARCH_7EM__
 	return HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_VEC_ACT_M;
+#elif defined(__x86_64__)
+	return mt_host_in_isr();
 #elif defined(__i386__)
 	return false;
 #else
@@ -64,6 +77,8 @@ unsigned int cmt_is_int_disabled() {
 	unsigned int ret;
 	asm ("MRS %[result], PRIMASK\n" : [result] "=r" (ret));
 	return (ret & 0x01);
+#elif defined(__x86_64__)
+	return mt_host_int_disabled();
 #elif defined(__i386__)
 	return false;
 #else
@@ -74,6 +89,8 @@ unsigned int cmt_is_int_disabled() {
 void cmt_disable_int() {
 #ifdef ENERGIA
 	ROM_IntMasterDisable();
+#elif defined(__x86_64__)
+	mt_host_int_disable();
 #elif defined(__i386__)
 	return;
 #else
@@ -84,6 +101,8 @@ void cmt_disable_int() {
 void cmt_enable_int() {
 #ifdef ENERGIA
 	ROM_IntMasterEnable();
+#elif defined(__x86_64__)
+	mt_host_int_enable();
 #elif defined(__i386__)
 	return;
 #else
@@ -104,17 +123,31 @@ void cmt_yeld() {
 		return;
 	cmt_disable_int();
 	prev = cmt_data->current_task;
-	next = prev;
-	for (int n = 0; n < CMT_MAX_TASKS; n++) {
-		next = (next + 1) % CMT_MAX_TASKS;
-		if (cmt_data->tasks[next].status == CMT_STATUS_READY)
-			break;
-	}
-	cmt_data->current_task = next;
-	if (cmt_data->tasks[next].status != CMT_STATUS_READY) {
+	if (prev != CMT_MAIN_TASK && cmt_data->tasks[prev].status == CMT_STATUS_READY)
+		mt_rq_rotate(&cmt_data->ready, cmt_data->tasks[prev].priority);
+	next = mt_rq_top(&cmt_data->ready);
+	if (next == MT_NO_TASK) {
+		if (prev == CMT_MAIN_TASK) {
+			cmt_enable_int();
+			return;
+		}
 		/* no tasks left - return to calling task (MAIN)*/
-		longjmp(cmt_data->tasks[CMT_MAIN_TASK].cpu_state, 1);
+		mt_stats_switch(&cmt_data->tasks[prev].stats, &cmt_data->tasks[CMT_MAIN_TASK].stats);
+		TRACE(TRACE_EVENT_SWITCH, CMT_MAIN_TASK);
+		cmt_data->current_task = CMT_MAIN_TASK;
+		/* save the task context - it may be blocked and resumed later */
+		if (setjmp(cmt_data->tasks[prev].cpu_state) == 0)
+			longjmp(cmt_data->tasks[CMT_MAIN_TASK].cpu_state, 1);
+		cmt_enable_int();
+		return;
 	}
+	if (next == prev) {
+		cmt_enable_int();
+		return;
+	}
+	mt_stats_switch(&cmt_data->tasks[prev].stats, &cmt_data->tasks[next].stats);
+	TRACE(TRACE_EVENT_SWITCH, next);
+	cmt_data->current_task = next;
 	if (setjmp(cmt_data->tasks[prev].cpu_state) == 0)
 		longjmp(cmt_data->tasks[next].cpu_state, 1);
 	cmt_enable_int();
@@ -130,16 +163,64 @@ void cmt_task_entry() {
 	int n = cmt_data->current_task;
 	cmt_enable_int();
 	cmt_data->tasks[n].entry_point();
-	/* the task terminated */
+	/* the task terminated - its stack is released here, as no other
+	 * task can allocate it before the switch in cmt_yeld() */
+	cmt_disable_int();
+	mt_rq_remove(&cmt_data->ready, n);
+	mt_stack_free(cmt_data->tasks[n].stack_base);
+	cmt_data->tasks[n].stack_base = NULL;
 	cmt_data->tasks[n].status = CMT_STATUS_FREE;
+	cmt_enable_int();
 	cmt_yeld();
 }
 
+/*
+ * Scheduler operations used by the blocking primitives.
+ * Called with interrupts disabled, except cmt_wait().
+ */
+static int cmt_current_task() {
+	return cmt_data->current_task;
+}
+
+static int cmt_task_priority(int id) {
+	return cmt_data->tasks[id].priority;
+}
+
+static void cmt_block(int id) {
+	cmt_task_t * task = &cmt_data->tasks[id];
+	if (task->status != CMT_STATUS_READY)
+		return;
+	mt_rq_remove(&cmt_data->ready, id);
+	task->status = CMT_STATUS_BLOCKED;
+	TRACE(TRACE_EVENT_BLOCK, id);
+}
+
+static void cmt_wake(int id) {
+	cmt_task_t * task = &cmt_data->tasks[id];
+	if (task->status != CMT_STATUS_BLOCKED)
+		return;
+	task->status = CMT_STATUS_READY;
+	mt_rq_insert(&cmt_data->ready, id, task->priority);
+	mt_stats_ready(&task->stats);
+	TRACE(TRACE_EVENT_READY, id);
+}
+
+static void cmt_wait() {
+	cmt_yeld();
+}
+
+static const mt_scheduler_t cmt_scheduler = {
+	cmt_current_task,
+	cmt_task_priority,
+	cmt_block,
+	cmt_wake,
+	cmt_wait
+};
+
 /*
  * Create a new instance of the Cooperative task scheduler.
  */
 CooperativeScheduler::CooperativeScheduler() {
-	data.stack_adr = NULL;
 	data.running = 0;
 }
 
@@ -149,10 +230,15 @@ CooperativeScheduler::CooperativeScheduler() {
 void CooperativeScheduler::begin(int stack_size) {
 	cmt_data = &data;
 	data.stack_size = stack_size;
-	data.stack_adr = NULL;
 	data.running = 0;
-	for (int i = 0; i < CMT_MAX_TASKS; i++)
+	mt_rq_init(&data.ready);
+	for (int i = 0; i < CMT_MAX_TASKS; i++) {
 		data.tasks[i].status = CMT_STATUS_FREE;
+		data.tasks[i].priority = MT_DEFAULT_PRIORITY;
+		data.tasks[i].stack_base = NULL;
+		data.tasks[i].stack_size = 0;
+		mt_stats_init(&data.tasks[i].stats);
+	}
 }
 
 /*
@@ -163,80 +249,122 @@ void CooperativeScheduler::begin() {
 }
 
 /*
- * Create a task with 'entry' entry point.
- * Returns true/false if the task was created.
- * If the constant CMT_PREALLOC_STACK was 1
- * a task can be created inside running tasks.
+ * Create a task with 'entry' entry point and the default priority.
  */
 bool CooperativeScheduler::create_task(void (*entry)(void)) {
+	return create_task(entry, MT_DEFAULT_PRIORITY, data.stack_size);
+}
+
+/*
+ * Create a task with 'entry' entry point and the given priority.
+ */
+bool CooperativeScheduler::create_task(void (*entry)(void), int priority) {
+	return create_task(entry, priority, data.stack_size);
+}
+
+/*
+ * Create a task with 'entry' entry point, the given priority
+ * (MT_LOWEST_PRIORITY to MT_HIGHEST_PRIORITY) and a stack of
+ * 'stack_size' bytes taken from the stack pool. On each yeld the first
+ * ready task of the highest priority runs; tasks of the same priority
+ * run in round-robin.
+ * Tasks can be created before run() or inside running tasks.
+ * Returns true/false if the task was created.
+ */
+bool CooperativeScheduler::create_task(void (*entry)(void), int priority, int stack_size) {
 	for (int i = 0; i < CMT_MAX_TASKS; i++) {
 		if (i == CMT_MAIN_TASK || data.tasks[i].status != CMT_STATUS_FREE)
 			continue;
+		if (stack_size < MT_MIN_STACK_SIZE)
+			stack_size = MT_MIN_STACK_SIZE;
+		stack_size = (stack_size + MT_STACK_ALIGN - 1) & ~(MT_STACK_ALIGN - 1);
+		void * stack = mt_stack_alloc(stack_size);
+		if (!stack)
+			return false;
+		mt_stack_paint(stack, stack_size);
 		/* initilize the task structure */
 		setjmp(data.tasks[i].cpu_state);
-		data.tasks[i].cpu_state[CMT_CPU_REG_PC] = (int) &cmt_task_entry;
+		CMT_CPU_REG(data.tasks[i].cpu_state, CMT_CPU_REG_PC) = CMT_CPU_VALUE(&cmt_task_entry);
+		CMT_CPU_REG(data.tasks[i].cpu_state, CMT_CPU_REG_SP) = CMT_CPU_VALUE(CMT_CPU_INITIAL_SP((char *) stack + stack_size));
 		data.tasks[i].entry_point = entry;
-		if (data.running) {
-#if CMT_PREALLOC_STACK
-			data.tasks[i].cpu_state[CMT_CPU_REG_SP] = (int) (data.stack_adr + (data.stack_size * i));
-			data.tasks[i].status = CMT_STATUS_READY;
-#else
-			/* running tasks and no stack pre-allocated */
-			return false;
-#endif
-		} else {
-			/* if not running, stack is initilized later in cmt_run_tasks() */
-			data.tasks[i].status = CMT_STATUS_CREATED;
-		}
+		data.tasks[i].priority = mt_rq_priority(priority);
+		data.tasks[i].stack_base = stack;
+		data.tasks[i].stack_size = stack_size;
+		data.tasks[i].status = CMT_STATUS_READY;
+		mt_rq_insert(&data.ready, i, data.tasks[i].priority);
+		mt_stats_init(&data.tasks[i].stats);
+		mt_stats_ready(&data.tasks[i].stats);
 		return true;
 	}
 	return false;
 }
 
 /*
- * Alocates stack space and then run the scheduled tasks.
+ * Returns true while there are tasks ready or blocked.
+ */
+bool CooperativeScheduler::has_tasks() {
+	for (int i = 0; i < CMT_MAX_TASKS; i++)
+		if (i != CMT_MAIN_TASK && data.tasks[i].status >= CMT_STATUS_READY)
+			return true;
+	return false;
+}
+
+/*
+ * Run the scheduled tasks.
  * Blocks until the last task exits.
  */
 void CooperativeScheduler::run() {
-	int num_tasks = 0;
-	int size;
-
 	if (data.running)
 		return;
 
-#if CMT_PREALLOC_STACK
-	num_tasks = CMT_MAX_TASKS - 1;
-#else
-	/* determine number os tasks to run */
-	for (int i = 0; i < CMT_MAX_TASKS; i++)
-	if (data.tasks[i].status != CMT_STATUS_FREE)
-	num_tasks++;
-#endif
-
-	if (data.stack_size < 256)
-		data.stack_size = CMT_STACK_SIZE;
+	/* set current task MAIN and execute first task */
+	data.current_task = CMT_MAIN_TASK;
 
-	data.stack_size = data.stack_size & 0xFFFFFFFC;
-	size = num_tasks * data.stack_size / sizeof(int);
+#if MT_KERNEL_PRIORITY && defined(ENERGIA)
+	/* the millisecond tick wakes the sleeping tasks */
+	ROM_IntPrioritySet(INT_TIMER5A, MT_KERNEL_PRIORITY);
+#endif
+	mt_stats_start();
+	data.running = 1;
+	mt_scheduler = &cmt_scheduler;
+	/* the MAIN task is resumed when no task is ready */
+	while (has_tasks()) {
+		cmt_yeld();
+		cmt_disable_int();
+		if (mt_rq_top(&data.ready) == MT_NO_TASK)
+			mt_idle();
+		cmt_enable_int();
+	}
+	mt_scheduler = NULL;
+	data.running = 0;
+}
 
-	/* create the stack memory for the tasks */
-	unsigned int temp_stack[size];
+/*
+ * Returns the number of bytes of the stack of 'task' that were never
+ * used, or -1 if there is no such task. The MAIN task stack is not
+ * tracked.
+ */
+int CooperativeScheduler::getStackHighWater(int task) {
+	if (task <= CMT_MAIN_TASK || task >= CMT_MAX_TASKS)
+		return -1;
+	if (data.tasks[task].status < CMT_STATUS_READY)
+		return -1;
+	return mt_stack_unused(data.tasks[task].stack_base, data.tasks[task].stack_size);
+}
 
-	/* alloc stack for each task */
-	data.stack_adr = (void *) temp_stack;
+/*
+ * Prints the CPU time, switches, worst wake up latency and stack usage
+ * of each task. The time of the MAIN task (task 0) is the idle time.
+ */
+void CooperativeScheduler::printStats(Print & out) {
+	unsigned long long total = 0;
+	for (int i = 0; i < CMT_MAX_TASKS; i++)
+		total += data.tasks[i].stats.cycles;
+	mt_stats_print_header(out);
 	for (int i = 0; i < CMT_MAX_TASKS; i++) {
-		if (i == CMT_MAIN_TASK)
+		cmt_task_t * task = &data.tasks[i];
+		if (i != CMT_MAIN_TASK && task->status < CMT_STATUS_READY)
 			continue;
-		if (data.tasks[i].status == CMT_STATUS_CREATED) {
-			data.tasks[i].cpu_state[CMT_CPU_REG_SP] = (int) (data.stack_adr + (data.stack_size * i));
-			data.tasks[i].status = CMT_STATUS_READY;
-		}
+		mt_stats_print(out, i, task->priority, &task->stats, total, task->stack_size, getStackHighWater(i));
 	}
-
-	/* set current task MAIN and execute first task */
-	data.current_task = CMT_MAIN_TASK;
-
-	data.running = 1;
-	cmt_yeld();
-	data.running = 0;
 }
@@ -0,0 +1,114 @@
+/******************************************
+ * Coroutine.cpp
+ * Stackless coroutines for the Multitask library.
+ ******************************************
+ Copyright (c) 2014 Jose Ferreira
+
+ This library is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library.
+ If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+
+#ifdef ENERGIA
+
+#include "Energia.h"
+#include "utility/Coroutine.h"
+#include "utility/CooperativeScheduler.h"
+
+#elif defined(__x86_64__)
+
+#include "HostPort.h"
+#include "Coroutine.h"
+#include "CooperativeScheduler.h"
+
+#else
+
+#include "Coroutine.h"
+
+#error "Unsupported arch for the Multitask library"
+
+#endif
+
+CoroutineScheduler::CoroutineScheduler() {
+	head = NULL;
+	tail = NULL;
+}
+
+/*
+ * Adds a coroutine at the end of the list. It starts from CO_BEGIN().
+ */
+void CoroutineScheduler::add(Coroutine & co) {
+	co.reset();
+	co.co_next = NULL;
+	if (tail)
+		tail->co_next = &co;
+	else
+		head = &co;
+	tail = &co;
+}
+
+/*
+ * Removes a coroutine from the list.
+ */
+void CoroutineScheduler::remove(Coroutine & co) {
+	Coroutine * prev = NULL;
+	for (Coroutine * c = head; c; prev = c, c = c->co_next) {
+		if (c != &co)
+			continue;
+		if (prev)
+			prev->co_next = c->co_next;
+		else
+			head = c->co_next;
+		if (tail == c)
+			tail = prev;
+		return;
+	}
+}
+
+/*
+ * Resumes each coroutine once. The coroutines that terminate are removed.
+ * Returns the number of coroutines left.
+ */
+int CoroutineScheduler::runOnce() {
+	int count = 0;
+	Coroutine * prev = NULL;
+	Coroutine * c = head;
+	while (c) {
+		Coroutine * next = c->co_next;
+		if (c->run() >= CO_EXITED) {
+			if (prev)
+				prev->co_next = next;
+			else
+				head = next;
+			if (tail == c)
+				tail = prev;
+		} else {
+			prev = c;
+			count++;
+		}
+		c = next;
+	}
+	return count;
+}
+
+/*
+ * Runs the coroutines until all of them terminate.
+ * Inside a task of the CooperativeScheduler, the other tasks run between
+ * two rounds: the coroutines share the yield points of the task.
+ */
+void CoroutineScheduler::run() {
+	while (runOnce())
+		cmt_yeld();
+}
@@ -1,2 +1,5 @@
 #include "utility/CooperativeScheduler.h"
+#include "utility/Coroutine.h"
 #include "utility/PreemptiveScheduler.h"
+#include "utility/SchedulerOps.h"
+#include "utility/TaskSync.h"
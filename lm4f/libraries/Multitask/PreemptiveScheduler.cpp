@@ -30,6 +30,19 @@
 #include "driverlib/sysctl.h"
 #include "driverlib/timer.h"
 #include "utility/PreemptiveScheduler.h"
+#include "utility/StackPool.h"
+#include "utility/SchedulerOps.h"
+#include "utility/TaskStats.h"
+
+#elif defined(__x86_64__)
+
+#include <signal.h>
+#include <ucontext.h>
+#include "HostPort.h"
+#include "PreemptiveScheduler.h"
+#include "StackPool.h"
+#include "SchedulerOps.h"
+#include "TaskStats.h"
 
 #else
 
@@ -41,74 +54,348 @@
 
 #define INT_PROTECT_INIT(oldLevel)  int oldLevel
 #define INT_PROTECT(oldLevel)       do{oldLevel=pmt_disable_int();}while(0)
-#define INT_UNPROTECT(oldLevel)     do{if(!oldLevel)pmt_enable_int();}while(0)
+#define INT_UNPROTECT(oldLevel)     mt_unlock(oldLevel)
 
 pmt_data_t * pmt_data = 0;
 
 /*
- * Disable interrupts.
- * Return true if interrupts are already disabled, or false otherwise.
+ * Disable the interrupts that use the scheduler (mt_lock()).
+ * Return the previous state, for INT_UNPROTECT().
  */
 int pmt_disable_int() {
-#ifdef ENERGIA
-	return ROM_IntMasterDisable();
-#else
-#error "Unsupported arch for the preemptive scheduler"
-#endif
+	return mt_lock();
 }
 
 /*
- * Enable interrupts.
+ * Enable interrupts, outside of any critical section.
  */
 void pmt_enable_int() {
-#ifdef ENERGIA
-	ROM_IntMasterEnable();
+	mt_unlock(0);
+}
+
+/*
+ * Requests a context switch.
+ * The switch itself is done by the PendSV handler, which runs at the lowest
+ * priority, after all the pending interrupts are serviced.
+ */
+void pmt_request_switch() {
+#ifdef __ARM_ARCH_7EM__
+	HWREG(NVIC_INT_CTRL) = NVIC_INT_CTRL_PEND_SV;
+#elif defined(__x86_64__)
+	mt_host_request_pendsv();
 #else
 #error "Unsupported arch for the preemptive scheduler"
 #endif
 }
 
-void pmt_switch_context() {
-	if (!pmt_data || !pmt_data->running)
-		return;
-	int prev = pmt_data->current_task;
-	int next = prev;
-	pmt_task_t * prevTask = &pmt_data->tasks[prev];
-	pmt_task_t * nextTask;
-	for (int n = 0; n < PMT_MAX_TASKS; n++) {
-		next = ((next + 1) % PMT_MAX_TASKS);
-		nextTask = &pmt_data->tasks[next];
-		if (nextTask->status == PMT_STATUS_READY_INT)
-			break;
+/*
+ * Yelds the execution of the current task to the next ready task of the
+ * same priority.
+ */
+void pmt_yield() {
+	INT_PROTECT_INIT(oldLevel);
+	INT_PROTECT(oldLevel);
+	if (pmt_data && pmt_data->running) {
+		pmt_task_t * task = &pmt_data->tasks[pmt_data->current_task];
+		if (pmt_data->current_task != PMT_MAIN_TASK && task->status == PMT_STATUS_READY)
+			mt_rq_rotate(&pmt_data->ready, task->priority);
 	}
+	pmt_request_switch();
+	INT_UNPROTECT(oldLevel);
+}
+
+/*
+ * Selects the next task to run: the first one of the highest priority list.
+ * Called from the PendSV handler with interrupts disabled, after r4-r11 of
+ * the previous task were saved on its stack.
+ * Returns the task control block of the task to resume.
+ */
+extern "C" pmt_task_t * pmt_switch_context(void * sp, unsigned int exc_return) {
+	static pmt_task_t idle_context;
+	if (!pmt_data || !pmt_data->running) {
+		/* scheduler not running - resume the interrupted code */
+		idle_context.sp = sp;
+		idle_context.exc_return = exc_return;
+		return &idle_context;
+	}
+	pmt_task_t * prevTask = &pmt_data->tasks[pmt_data->current_task];
+	prevTask->sp = sp;
+	prevTask->exc_return = exc_return;
+	if (prevTask->status == PMT_STATUS_EXITED) {
+		/* the stack is no longer in use - return it to the pool */
+		mt_stack_free(prevTask->stack_base);
+		prevTask->stack_base = NULL;
+		prevTask->status = PMT_STATUS_FREE;
+	}
+	int next = mt_rq_top(&pmt_data->ready);
+	if (next == MT_NO_TASK) {
+		/* no tasks left - return to MAIN task */
+		next = PMT_MAIN_TASK;
+	}
+	mt_stats_switch(&prevTask->stats, &pmt_data->tasks[next].stats);
+	if (&pmt_data->tasks[next] != prevTask)
+		TRACE(TRACE_EVENT_SWITCH, next);
 	pmt_data->current_task = next;
-	int prevStatus = prevTask->status;
-	if (prevStatus == PMT_STATUS_READY_JMP || prevStatus == PMT_STATUS_PREPARING)
-		prevTask->status = PMT_STATUS_READY_INT;
-	if (setjmp(prevTask->cpu_context) != 0)
+	return &pmt_data->tasks[next];
+}
+
+/*
+ * Scheduler operations used by the blocking primitives.
+ * Called with interrupts disabled.
+ */
+static int pmt_current_task() {
+	return pmt_data->current_task;
+}
+
+static int pmt_task_priority(int id) {
+	return pmt_data->tasks[id].priority;
+}
+
+static void pmt_block(int id) {
+	pmt_task_t * task = &pmt_data->tasks[id];
+	if (task->status != PMT_STATUS_READY)
 		return;
-	if (prev == next && nextTask->status != PMT_STATUS_READY_INT) {
-		/* no tasks left - return to MAIN task */
-		pmt_data->current_task = PMT_MAIN_TASK;
-		nextTask = nextTask = &pmt_data->tasks[PMT_MAIN_TASK];
+	mt_rq_remove(&pmt_data->ready, id);
+	task->status = PMT_STATUS_BLOCKED;
+	TRACE(TRACE_EVENT_BLOCK, id);
+	if (id == pmt_data->current_task)
+		pmt_request_switch();
+}
+
+static void pmt_wake(int id) {
+	pmt_task_t * task = &pmt_data->tasks[id];
+	if (task->status != PMT_STATUS_BLOCKED)
+		return;
+	task->status = PMT_STATUS_READY;
+	mt_rq_insert(&pmt_data->ready, id, task->priority);
+	mt_stats_ready(&task->stats);
+	TRACE(TRACE_EVENT_READY, id);
+	/* preempts the current task if the woken one has higher priority */
+	int current = pmt_data->current_task;
+	if (current == PMT_MAIN_TASK || task->priority > pmt_data->tasks[current].priority)
+		pmt_request_switch();
+}
+
+static void pmt_wait() {
+	/* the switch was requested by pmt_block(), and happens as soon
+	 * as interrupts are enabled */
+	pmt_request_switch();
+}
+
+static const mt_scheduler_t pmt_scheduler = {
+	pmt_current_task,
+	pmt_task_priority,
+	pmt_block,
+	pmt_wake,
+	pmt_wait
+};
+
+/*
+ * Worker task: runs the work deferred by the interrupt handlers with
+ * deferWork(), at the priority it was created with.
+ */
+static mt_wait_list_t pmt_worker_waiting = 0;
+static volatile int pmt_worker_pending = 0;
+
+static void pmt_worker_wake() {
+	int oldLevel = mt_lock();
+	pmt_worker_pending = 1;
+	mt_wake_one(&pmt_worker_waiting);
+	mt_unlock(oldLevel);
+}
+
+static void pmt_worker() {
+	while (true) {
+		int oldLevel = mt_lock();
+		while (!pmt_worker_pending) {
+			mt_wait(&pmt_worker_waiting, oldLevel);
+			oldLevel = mt_lock();
+		}
+		pmt_worker_pending = 0;
+		mt_unlock(oldLevel);
+		runDeferredWork();
 	}
-	longjmp(nextTask->cpu_context, 1);
+}
+
+/*
+ * Periodic tasks: each one runs its job when the release timer reaches its
+ * release time, then waits for the next release.
+ */
+static void pmt_release_timer_set(unsigned int delay);
+
+static pmt_periodic_t * pmt_find_periodic(pmt_data_t * data, int id) {
+	for (int i = 0; i < PMT_MAX_PERIODIC; i++)
+		if (data->periodic[i].task == id)
+			return &data->periodic[i];
+	return NULL;
+}
+
+/*
+ * Wakes the periodic tasks whose release time is reached, and programs the
+ * release timer for the earliest release of the others.
+ * Called with interrupts disabled.
+ */
+static void pmt_release() {
+	unsigned long long now = mt_cycles();
+	unsigned int delay = 0;
+	for (int i = 0; i < PMT_MAX_PERIODIC; i++) {
+		pmt_periodic_t * p = &pmt_data->periodic[i];
+		if (p->task == MT_NO_TASK || !p->waiting)
+			continue;
+		if (p->release <= now) {
+			p->waiting = 0;
+			TRACE(TRACE_EVENT_RELEASE, p->task);
+			pmt_wake(p->task);
+		} else {
+			unsigned long long left = p->release - now;
+			if (left > 0xFFFFFFFF)
+				left = 0xFFFFFFFF;
+			if (!delay || left < delay)
+				delay = (unsigned int) left;
+		}
+	}
+	pmt_release_timer_set(delay);
+}
+
+static void pmt_release_isr() {
+	if (!pmt_data || !pmt_data->running)
+		return;
+	int oldLevel = mt_lock();
+	pmt_release();
+	mt_unlock(oldLevel);
+}
+
+static void pmt_periodic_task() {
+	int id = pmt_data->current_task;
+	pmt_task_t * task = &pmt_data->tasks[id];
+	pmt_periodic_t * p = pmt_find_periodic(pmt_data, id);
+	/* the first release is when the task first runs */
+	int oldLevel = mt_lock();
+	p->release = mt_cycles();
+	mt_unlock(oldLevel);
+	while (!p->stopping) {
+		oldLevel = mt_lock();
+		unsigned long long start = mt_cycles();
+		unsigned long long used = mt_stats_runtime(&task->stats);
+		mt_unlock(oldLevel);
+
+		p->job();
+
+		oldLevel = mt_lock();
+		unsigned int exec = (unsigned int) (mt_stats_runtime(&task->stats) - used);
+		unsigned long long now = mt_cycles();
+		p->release += p->period;
+		/* the deadline of a job is the next release */
+		bool missed = now > p->release;
+		mt_periodic_record(&p->stats, (unsigned int) (start - (p->release - p->period)), exec, missed);
+		if (missed) {
+			/* the next job starts at once, the releases it overran are skipped */
+			p->release += (now - p->release) / p->period * p->period;
+		} else if (!p->stopping) {
+			p->waiting = 1;
+			pmt_block(id);
+			pmt_release();
+		}
+		mt_unlock(oldLevel);
+	}
+	oldLevel = mt_lock();
+	p->task = MT_NO_TASK;
+	mt_unlock(oldLevel);
 }
 
 #if defined(__ARM_ARCH_7EM__) && defined(ENERGIA)
+/*
+ * PendSV handler.
+ * Saves r4-r11 on the stack of the interrupted task, selects the next task
+ * and restores its r4-r11. The MAIN task runs on the MSP, the other tasks on
+ * the PSP: the stack in use is identified by bit 2 of EXC_RETURN, which is
+ * kept in the task control block.
+ * Tasks that used the FPU have bit 4 of EXC_RETURN cleared: only for them
+ * s16-s31 are saved too. The vstmdb also triggers the lazy stacking of
+ * s0-s15/FPSCR in the space the hardware reserved in the exception frame,
+ * so integer-only tasks never pay for the FP context.
+ */
+extern "C" void PendSVIntHandler(void) __attribute__((naked));
+extern "C" void PendSVIntHandler(void) {
+	asm volatile (
+			"    .fpu    fpv4-sp-d16\n"
+			"    cpsid   i\n"
+			"    tst     lr, #4\n"
+			"    ite     eq\n"
+			"    mrseq   r0, msp\n"
+			"    mrsne   r0, psp\n"
+			"    tst     lr, #0x10\n"
+			"    it      eq\n"
+			"    vstmdbeq r0!, {s16-s31}\n"
+			"    stmdb   r0!, {r4-r11}\n"
+			"    tst     lr, #4\n"
+			"    it      eq\n"
+			"    msreq   msp, r0\n"
+			"    mov     r1, lr\n"
+			"    bl      pmt_switch_context\n"
+			"    ldr     lr, [r0, #4]\n"
+			"    ldr     r0, [r0]\n"
+			"    ldmia   r0!, {r4-r11}\n"
+			"    tst     lr, #0x10\n"
+			"    it      eq\n"
+			"    vldmiaeq r0!, {s16-s31}\n"
+			"    tst     lr, #4\n"
+			"    ite     eq\n"
+			"    msreq   msp, r0\n"
+			"    msrne   psp, r0\n"
+			"    cpsie   i\n"
+			"    bx      lr\n"
+	);
+}
+
 extern "C" void ToneIntHandler(void) {
 	ROM_TimerIntClear(TIMER4_BASE, TIMER_TIMA_TIMEOUT);
-	pmt_switch_context();
+	pmt_yield();
+}
+
+extern "C" void PMT_RELEASE_HANDLER(void) {
+	ROM_TimerIntClear(PMT_RELEASE_TIMER, TIMER_TIMA_TIMEOUT);
+	pmt_release_isr();
+}
+
+/*
+ * Starts the release timer for 'delay' cycles, or stops it if 'delay' is 0.
+ */
+static void pmt_release_timer_set(unsigned int delay) {
+	ROM_TimerDisable(PMT_RELEASE_TIMER, TIMER_A);
+	if (!delay)
+		return;
+	ROM_TimerLoadSet(PMT_RELEASE_TIMER, TIMER_A, delay);
+	ROM_TimerEnable(PMT_RELEASE_TIMER, TIMER_A);
+}
+#elif defined(__x86_64__)
+/*
+ * PendSV handler of the host port, called with SIGALRM blocked.
+ * The context of the task switched out is resumed here.
+ */
+static void pmt_pendsv() {
+	if (!pmt_data || !pmt_data->running)
+		return;
+	pmt_task_t * prevTask = &pmt_data->tasks[pmt_data->current_task];
+	pmt_task_t * nextTask = pmt_switch_context(NULL, 0);
+	if (nextTask != prevTask)
+		swapcontext(&prevTask->context, &nextTask->context);
+}
+
+static void pmt_release_timer_set(unsigned int delay) {
+	mt_host_oneshot_start(delay ? pmt_release_isr : NULL, delay);
 }
 #endif
 
 void pmt_task_entry() {
 	int n = pmt_data->current_task;
 	/* execute task entry point */
-	pmt_enable_int();
 	pmt_data->tasks[n].entry_point();
-	/* task terminated */
-	pmt_data->tasks[n].status = PMT_STATUS_FREE;
+	/* task terminated - the slot is released by the next context switch */
+	pmt_disable_int();
+	mt_rq_remove(&pmt_data->ready, n);
+	pmt_data->tasks[n].status = PMT_STATUS_EXITED;
+	pmt_request_switch();
 	pmt_enable_int();
 	while (true) {
 	}
@@ -125,48 +412,111 @@ void PreemptiveScheduler::begin() {
 void PreemptiveScheduler::begin(int stack_size) {
 	data.running = false;
 	data.current_task = PMT_MAIN_TASK;
-	data.stack_adr = NULL;
 	data.stack_size = stack_size;
+	mt_rq_init(&data.ready);
 	for (int i = 0; i < PMT_MAX_TASKS; i++) {
 		data.tasks[i].status = PMT_STATUS_FREE;
+		data.tasks[i].priority = MT_DEFAULT_PRIORITY;
+		data.tasks[i].stack_base = NULL;
+		data.tasks[i].stack_size = 0;
 		data.tasks[i].entry_point = NULL;
-		memset(data.tasks[i].cpu_context, 0, sizeof(data.tasks[i].cpu_context));
+		data.tasks[i].sp = NULL;
+		data.tasks[i].exc_return = 0;
+		mt_stats_init(&data.tasks[i].stats);
 	}
 	data.tasks[PMT_MAIN_TASK].status = PMT_STATUS_CREATED;
+	data.worker_task = MT_NO_TASK;
+	for (int i = 0; i < PMT_MAX_PERIODIC; i++)
+		data.periodic[i].task = MT_NO_TASK;
+	data.release_timer = false;
 	pmt_data = &data;
 }
 
+/*
+ * Builds the initial stack frame of a task, as if it was interrupted just
+ * before the first instruction of pmt_task_entry(), and queues it as ready.
+ */
+void PreemptiveScheduler::init_task_stack(int num_task) {
+	pmt_task_t * task = &data.tasks[num_task];
+#ifdef __ARM_ARCH_7EM__
+	unsigned int * sp = (unsigned int *) ((char *) task->stack_base + task->stack_size);
+	/* hardware frame: r0-r3, r12, lr, pc, xpsr */
+	*(--sp) = PMT_INITIAL_XPSR;
+	*(--sp) = ((unsigned int) &pmt_task_entry) & ~1;
+	*(--sp) = 0;
+	for (int n = 0; n < 5; n++)
+		*(--sp) = 0;
+	/* software frame: r4-r11 */
+	for (int n = 0; n < 8; n++)
+		*(--sp) = 0;
+	task->sp = sp;
+	task->exc_return = PMT_EXC_RETURN_PSP;
+#else
+	/* the task starts with SIGALRM enabled, as after PendSV */
+	getcontext(&task->context);
+	task->context.uc_stack.ss_sp = task->stack_base;
+	task->context.uc_stack.ss_size = task->stack_size;
+	task->context.uc_link = NULL;
+	sigemptyset(&task->context.uc_sigmask);
+	makecontext(&task->context, pmt_task_entry, 0);
+#endif
+	task->status = PMT_STATUS_READY;
+	mt_rq_insert(&data.ready, num_task, task->priority);
+	mt_stats_init(&task->stats);
+	mt_stats_ready(&task->stats);
+}
+
 bool PreemptiveScheduler::create_task(void (*entry)(void)) {
+	return create_task(entry, MT_DEFAULT_PRIORITY, data.stack_size);
+}
+
+bool PreemptiveScheduler::create_task(void (*entry)(void), int priority) {
+	return create_task(entry, priority, data.stack_size);
+}
+
+/*
+ * Create a task with 'entry' entry point, the given priority
+ * (MT_LOWEST_PRIORITY to MT_HIGHEST_PRIORITY, higher runs first)
+ * and a stack of 'stack_size' bytes taken from the stack pool.
+ * Tasks of the same priority share the CPU in round-robin.
+ * Tasks can be created before run() or by running tasks.
+ * Returns true/false if the task was created.
+ */
+bool PreemptiveScheduler::create_task(void (*entry)(void), int priority, int stack_size) {
+	return add_task(entry, priority, stack_size) != MT_NO_TASK;
+}
+
+/*
+ * Returns the id of the new task, or MT_NO_TASK.
+ */
+int PreemptiveScheduler::add_task(void (*entry)(void), int priority, int stack_size) {
 	INT_PROTECT_INIT(oldLevel);
-	bool ret = false;
+	int ret = MT_NO_TASK;
 	INT_PROTECT(oldLevel);
 	for (int i = 0; i < PMT_MAX_TASKS; i++) {
 		if (i == PMT_MAIN_TASK || data.tasks[i].status != PMT_STATUS_FREE)
 			continue;
 
-#if PMT_PREALLOC_STACK
-		/* initialize CPU context to fork task */
-		setjmp(data.tasks[i].cpu_context);
-		data.tasks[i].cpu_context[PMT_CPU_REG_SP] = (int) (data.stack_adr + (data.stack_size * i));
-		data.tasks[i].cpu_context[PMT_CPU_REG_PC] = (int) &pmt_task_entry;
-#else
-		if (data.running)
+		if (stack_size < MT_MIN_STACK_SIZE)
+			stack_size = MT_MIN_STACK_SIZE;
+		stack_size = (stack_size + MT_STACK_ALIGN - 1) & ~(MT_STACK_ALIGN - 1);
+		void * stack = mt_stack_alloc(stack_size);
+		if (!stack)
 			break;
-#endif
 
 		/* initilize the task structure */
-		data.tasks[i].status = PMT_STATUS_CREATED;
+		data.tasks[i].priority = mt_rq_priority(priority);
+		data.tasks[i].stack_base = stack;
+		data.tasks[i].stack_size = stack_size;
 		data.tasks[i].entry_point = entry;
-		/* if not running, stack is initilized later in run_tasks() */
-		ret = true;
-
-#if PMT_PREALLOC_STACK
-		if (data.running)
-		{
-			data.tasks[i].status = PMT_STATUS_READY_JMP;
-			fork_task(i);
-		}
-#endif
+		mt_stack_paint(stack, stack_size);
+		init_task_stack(i);
+		ret = i;
+
+		/* preempts the current task if the new one has higher priority */
+		int current = data.current_task;
+		if (data.running && (current == PMT_MAIN_TASK || data.tasks[i].priority > data.tasks[current].priority))
+			pmt_request_switch();
 
 		break;
 	}
@@ -174,44 +524,6 @@ bool PreemptiveScheduler::create_task(void (*entry)(void)) {
 	return ret;
 }
 
-void PreemptiveScheduler::fork_task(int num_task) {
-	int numThisTask = data.current_task;
-	pmt_task_t * thisTask = &data.tasks[numThisTask];
-	pmt_task_t * forkTask = &data.tasks[num_task];
-	if (forkTask->status == PMT_STATUS_READY_JMP) {
-		/* The next while is critical for task sincronization.
-		 * Do not make modifications if you do not know what are you doing.
-		 *  */
-		pmt_disable_int();
-		if (forkTask->status != PMT_STATUS_READY_JMP)
-			return;
-		thisTask->status = PMT_STATUS_PREPARING;
-		while (true) {
-			pmt_enable_int();
-			pmt_disable_int();
-			if (thisTask->status == PMT_STATUS_READY_INT) {
-				if (forkTask->status == PMT_STATUS_READY_JMP) {
-					data.current_task = num_task;
-					longjmp(forkTask->cpu_context, 1);
-				}
-				break;
-			}
-		}
-	}
-}
-
-void PreemptiveScheduler::fork_all() {
-	int numThisTask = data.current_task;
-	for (int n = 0; n < PMT_MAX_TASKS; n++) {
-		if (n == numThisTask)
-			continue;
-		if (data.tasks[n].status == PMT_STATUS_READY_JMP) {
-			fork_task(n);
-			pmt_enable_int();
-		}
-	}
-}
-
 #ifdef __ARM_ARCH_7EM__
 void PreemptiveScheduler::enable_timers() {
 	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER4);
@@ -221,6 +533,13 @@ void PreemptiveScheduler::enable_timers() {
 	ROM_IntEnable(INT_TIMER4A);
 	ROM_TimerIntEnable(TIMER4_BASE, TIMER_TIMA_TIMEOUT);
 	ROM_IntPrioritySet(INT_TIMER4A, 0xFF);
+	ROM_IntPrioritySet(FAULT_PENDSV, 0xFF);
+#if MT_KERNEL_PRIORITY
+	/* the millisecond tick wakes the sleeping tasks */
+	ROM_IntPrioritySet(INT_TIMER5A, MT_KERNEL_PRIORITY);
+#endif
+	/* FP context saved by the hardware only for tasks that use the FPU */
+	HWREG(NVIC_FPCC) |= NVIC_FPCC_ASPEN | NVIC_FPCC_LSPEN;
 }
 
 void PreemptiveScheduler::disable_timers() {
@@ -229,15 +548,185 @@ void PreemptiveScheduler::disable_timers() {
 	ROM_IntDisable(INT_TIMER4A);
 	ROM_TimerIntClear(TIMER4_BASE, TIMER_TIMA_TIMEOUT);
 	ROM_SysCtlPeripheralDisable(SYSCTL_PERIPH_TIMER4);
+	if (data.release_timer) {
+		ROM_TimerDisable(PMT_RELEASE_TIMER, TIMER_A);
+		ROM_TimerIntDisable(PMT_RELEASE_TIMER, TIMER_TIMA_TIMEOUT);
+		ROM_IntDisable(PMT_RELEASE_INT);
+		ROM_TimerIntClear(PMT_RELEASE_TIMER, TIMER_TIMA_TIMEOUT);
+		ROM_SysCtlPeripheralDisable(PMT_RELEASE_PERIPH);
+		data.release_timer = false;
+	}
+}
+
+/*
+ * The release timer is only taken when the first periodic task is created.
+ */
+void PreemptiveScheduler::enable_release_timer() {
+	if (data.release_timer)
+		return;
+	ROM_SysCtlPeripheralEnable(PMT_RELEASE_PERIPH);
+	ROM_TimerConfigure(PMT_RELEASE_TIMER, PMT_RELEASE_CFG);
+	ROM_TimerIntEnable(PMT_RELEASE_TIMER, TIMER_TIMA_TIMEOUT);
+#if MT_KERNEL_PRIORITY
+	ROM_IntPrioritySet(PMT_RELEASE_INT, MT_KERNEL_PRIORITY);
+#endif
+	ROM_IntEnable(PMT_RELEASE_INT);
+	data.release_timer = true;
+}
+#elif defined(__x86_64__)
+void PreemptiveScheduler::enable_timers() {
+	mt_host_set_pendsv(pmt_pendsv);
+	mt_host_timer_start(pmt_yield, PMT_SWITCH_PERIOD);
+}
+
+void PreemptiveScheduler::disable_timers() {
+	mt_host_timer_stop();
+	mt_host_set_pendsv(NULL);
+	mt_host_oneshot_start(NULL, 0);
+	data.release_timer = false;
+}
+
+void PreemptiveScheduler::enable_release_timer() {
+	data.release_timer = true;
 }
 #else
 #error "You must implement the enable_timers() and disable_timers() routines for you architecture."
 #endif
 
+/*
+ * Create the worker task, that runs the work deferred by the interrupt
+ * handlers (deferWork()), with the given priority. While it exists, the
+ * core drivers (UART receive, Ethernet, I2C slave callbacks) leave their
+ * processing to it, so tasks of higher priority are not delayed by it.
+ * The worker does not keep run() from returning.
+ * Returns true/false if the worker was created.
+ */
+bool PreemptiveScheduler::create_worker(int priority) {
+	INT_PROTECT_INIT(oldLevel);
+	bool ret = false;
+	INT_PROTECT(oldLevel);
+	if (data.worker_task == MT_NO_TASK) {
+		data.worker_task = add_task(pmt_worker, priority, data.stack_size);
+		if (data.worker_task != MT_NO_TASK) {
+			/* drains the work posted before */
+			pmt_worker_pending = 1;
+			registerDeferredWorker(pmt_worker_wake);
+			ret = true;
+		}
+	}
+	INT_UNPROTECT(oldLevel);
+	return ret;
+}
+
+bool PreemptiveScheduler::create_worker() {
+	return create_worker(MT_HIGHEST_PRIORITY);
+}
+
+/*
+ * Stops the worker task when run() ends. Called with interrupts disabled.
+ */
+void PreemptiveScheduler::stop_worker() {
+	int id = data.worker_task;
+	if (id == MT_NO_TASK)
+		return;
+	registerDeferredWorker(NULL);
+	mt_wake_all(&pmt_worker_waiting);
+	if (data.tasks[id].status == PMT_STATUS_READY)
+		mt_rq_remove(&data.ready, id);
+	mt_stack_free(data.tasks[id].stack_base);
+	data.tasks[id].stack_base = NULL;
+	data.tasks[id].status = PMT_STATUS_FREE;
+	data.worker_task = MT_NO_TASK;
+}
+
+/*
+ * Create a periodic task, with the given priority, that calls 'entry' every
+ * 'period_us' microseconds. The releases are driven by a hardware timer, so
+ * the period does not drift; the first release is when the task first runs.
+ * A job that ends after the next release is a deadline miss: the next job
+ * starts at once. The start jitter, execution time and misses of the jobs
+ * are recorded, see getPeriodicStats().
+ * Give the shorter periods the higher priorities (rate monotonic).
+ * Returns the task id, or MT_NO_TASK if the task was not created.
+ */
+int PreemptiveScheduler::create_periodic(void (*entry)(void), unsigned long period_us, int priority) {
+	INT_PROTECT_INIT(oldLevel);
+	int ret = MT_NO_TASK;
+	/*
+	 * p->period and the delay of the one-shot release timer are 32 bit
+	 * cycle counts; the limit keeps the period within half of their range
+	 */
+	if (!period_us || period_us > 0x7FFFFFFFUL / (F_CPU / 1000000))
+		return MT_NO_TASK;
+	INT_PROTECT(oldLevel);
+	for (int i = 0; i < PMT_MAX_PERIODIC; i++) {
+		pmt_periodic_t * p = &data.periodic[i];
+		if (p->task != MT_NO_TASK)
+			continue;
+		p->job = entry;
+		p->period_us = period_us;
+		p->period = period_us * (F_CPU / 1000000);
+		p->waiting = 0;
+		p->stopping = 0;
+		mt_periodic_init(&p->stats);
+		enable_release_timer();
+		p->task = add_task(pmt_periodic_task, priority, data.stack_size);
+		ret = p->task;
+		break;
+	}
+	INT_UNPROTECT(oldLevel);
+	return ret;
+}
+
+/*
+ * Stops a periodic task after its current job.
+ */
+void PreemptiveScheduler::stop_periodic(int task) {
+	INT_PROTECT_INIT(oldLevel);
+	INT_PROTECT(oldLevel);
+	pmt_periodic_t * p = task == MT_NO_TASK ? NULL : pmt_find_periodic(&data, task);
+	if (p && !p->stopping) {
+		p->stopping = 1;
+		if (p->waiting) {
+			p->waiting = 0;
+			pmt_wake(task);
+		}
+	}
+	INT_UNPROTECT(oldLevel);
+}
+
+/*
+ * Copies the timing of the jobs of a periodic task.
+ * Returns false if 'task' is not a periodic task.
+ */
+bool PreemptiveScheduler::getPeriodicStats(int task, mt_periodic_stats_t & stats) {
+	INT_PROTECT_INIT(oldLevel);
+	INT_PROTECT(oldLevel);
+	pmt_periodic_t * p = task == MT_NO_TASK ? NULL : pmt_find_periodic(&data, task);
+	if (p)
+		stats = p->stats;
+	INT_UNPROTECT(oldLevel);
+	return p != NULL;
+}
+
+/*
+ * Prints the timing of the jobs of each periodic task.
+ */
+void PreemptiveScheduler::printPeriodicStats(Print & out) {
+	INT_PROTECT_INIT(oldLevel);
+	for (int i = 0; i < PMT_MAX_PERIODIC; i++) {
+		INT_PROTECT(oldLevel);
+		pmt_periodic_t p = data.periodic[i];
+		INT_UNPROTECT(oldLevel);
+		if (p.task != MT_NO_TASK)
+			mt_periodic_print(out, p.task, p.period_us, &p.stats);
+	}
+}
+
 bool PreemptiveScheduler::has_tasks() {
 	pmt_disable_int();
 	for (int i = 0; i < PMT_MAX_TASKS; i++)
-		if (pmt_data->tasks[i].status >= PMT_STATUS_PREPARING) {
+		if (i != PMT_MAIN_TASK && i != pmt_data->worker_task && pmt_data->tasks[i].status >= PMT_STATUS_READY) {
 			pmt_enable_int();
 			return true;
 		}
@@ -245,34 +734,26 @@ bool PreemptiveScheduler::has_tasks() {
 	return false;
 }
 
-void PreemptiveScheduler::run() {
+/*
+ * Idle loop step of the MAIN task: when no task is ready, stops the
+ * switch tick and sleeps until the next deadline or interrupt.
+ */
+void PreemptiveScheduler::idle() {
 	pmt_disable_int();
-
-	/* determine number os tasks to run */
-	int num_tasks = 0;
-
-#if PMT_PREALLOC_STACK
-	num_tasks = PMT_MAX_TASKS - 1;
+	if (mt_rq_top(&data.ready) == MT_NO_TASK) {
+#ifdef __ARM_ARCH_7EM__
+		ROM_TimerDisable(TIMER4_BASE, TIMER_A);
+		mt_idle();
+		ROM_TimerEnable(TIMER4_BASE, TIMER_A);
 #else
-	for (int i = 0; i < PMT_MAX_TASKS; i++)
-		if (data.tasks[i].status != PMT_STATUS_FREE)
-			num_tasks++;
+		mt_idle();
 #endif
-
-	int size = num_tasks * data.stack_size / sizeof(int);
-
-	unsigned int temp_stack[size];
-
-	/* aloc stack for the tasks */
-	data.stack_adr = (void *) temp_stack;
-	for (int i = 0; i < PMT_MAX_TASKS; i++) {
-		if (data.tasks[i].status == PMT_STATUS_CREATED && i != PMT_MAIN_TASK) {
-			setjmp(data.tasks[i].cpu_context);
-			data.tasks[i].cpu_context[PMT_CPU_REG_SP] = (int) (data.stack_adr + (data.stack_size * i));
-			data.tasks[i].cpu_context[PMT_CPU_REG_PC] = (int) &pmt_task_entry;
-			data.tasks[i].status = PMT_STATUS_READY_JMP;
-		}
 	}
+	pmt_enable_int();
+}
+
+void PreemptiveScheduler::run() {
+	pmt_disable_int();
 
 	/* set current task MAIN and execute first task */
 	data.current_task = PMT_MAIN_TASK;
@@ -281,21 +762,75 @@ void PreemptiveScheduler::run() {
 
 	enable_timers();
 
+	mt_stats_start();
+
 	data.running = true;
 
+	mt_scheduler = &pmt_scheduler;
+
 	pmt_enable_int();
 
-	while (true) {
-		fork_all();
-		data.tasks[PMT_MAIN_TASK].status = PMT_STATUS_FREE; /* pauses the main task */
-		if (!has_tasks())
-			break;
+	/* the MAIN task is only resumed when no other task is ready */
+	while (has_tasks()) {
+		pmt_request_switch();
+		idle();
 	}
 
+	pmt_disable_int();
+
+	stop_worker();
+
 	data.running = false;
 
+	mt_scheduler = NULL;
+
 	disable_timers();
 
 	pmt_data = NULL;
+
+	pmt_enable_int();
+
+	/* the work posted after the worker stopped */
+	runDeferredWork();
 }
 
+/*
+ * Returns the number of bytes of the stack of 'task' that were never
+ * used, or -1 if there is no such task. The MAIN task stack is not
+ * tracked.
+ */
+int PreemptiveScheduler::getStackHighWater(int task) {
+	if (task <= PMT_MAIN_TASK || task >= PMT_MAX_TASKS)
+		return -1;
+	INT_PROTECT_INIT(oldLevel);
+	int ret = -1;
+	INT_PROTECT(oldLevel);
+	pmt_task_t * t = &data.tasks[task];
+	if (t->status >= PMT_STATUS_READY && t->status != PMT_STATUS_EXITED)
+		ret = mt_stack_unused(t->stack_base, t->stack_size);
+	INT_UNPROTECT(oldLevel);
+	return ret;
+}
+
+/*
+ * Prints the CPU time, switches, worst wake up latency and stack usage
+ * of each task. The time of the MAIN task (task 0) is the idle time.
+ */
+void PreemptiveScheduler::printStats(Print & out) {
+	unsigned long long total = 0;
+	INT_PROTECT_INIT(oldLevel);
+	INT_PROTECT(oldLevel);
+	for (int i = 0; i < PMT_MAX_TASKS; i++)
+		total += data.tasks[i].stats.cycles;
+	INT_UNPROTECT(oldLevel);
+	mt_stats_print_header(out);
+	for (int i = 0; i < PMT_MAX_TASKS; i++) {
+		INT_PROTECT(oldLevel);
+		pmt_task_t task = data.tasks[i];
+		INT_UNPROTECT(oldLevel);
+		if (i != PMT_MAIN_TASK && (task.status < PMT_STATUS_READY || task.status == PMT_STATUS_EXITED))
+			continue;
+		int unused = i == PMT_MAIN_TASK ? -1 : getStackHighWater(i);
+		mt_stats_print(out, i, task.priority, &task.stats, total, task.stack_size, unused);
+	}
+}
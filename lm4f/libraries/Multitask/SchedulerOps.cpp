@@ -0,0 +1,286 @@
+/******************************************
+ * SchedulerOps.cpp
+ * Wait lists for the Multitask blocking primitives.
+ ******************************************
+ Copyright (c) 2014 Jose Ferreira
+
+ This library is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library.
+ If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+
+#ifdef ENERGIA
+
+#include "Energia.h"
+#include "driverlib/rom.h"
+#include "utility/SchedulerOps.h"
+#include "utility/ReadyQueue.h"
+
+#elif defined(__x86_64__)
+
+#include "HostPort.h"
+#include "SchedulerOps.h"
+#include "ReadyQueue.h"
+
+#else
+
+#include "SchedulerOps.h"
+
+#error "Unsupported arch for the Multitask library"
+
+#endif
+
+const mt_scheduler_t * volatile mt_scheduler = NULL;
+
+/*
+ * Sleep list: the tasks waiting with a deadline, sorted by deadline.
+ * Only its head is checked on each millisecond tick.
+ */
+static signed char mt_sleep_next[MT_QUEUE_SIZE];
+static unsigned long mt_sleep_tick[MT_QUEUE_SIZE];
+static int mt_sleep_head = -1;
+static unsigned int mt_sleeping = 0;         /* bit n set: task n is in the sleep list */
+
+/* wait list each task is waiting on, if any */
+static mt_wait_list_t * mt_waiting_on[MT_QUEUE_SIZE];
+
+static void mt_sleep_insert(int id, unsigned long deadline) {
+	int prev = -1;
+	int next = mt_sleep_head;
+	while (next >= 0 && (long) (mt_sleep_tick[next] - deadline) <= 0) {
+		prev = next;
+		next = mt_sleep_next[next];
+	}
+	mt_sleep_tick[id] = deadline;
+	mt_sleep_next[id] = next;
+	if (prev < 0)
+		mt_sleep_head = id;
+	else
+		mt_sleep_next[prev] = id;
+	mt_sleeping |= (1u << id);
+}
+
+static void mt_sleep_remove(int id) {
+	if (!(mt_sleeping & (1u << id)))
+		return;
+	int prev = -1;
+	int next = mt_sleep_head;
+	while (next != id) {
+		prev = next;
+		next = mt_sleep_next[next];
+	}
+	if (prev < 0)
+		mt_sleep_head = mt_sleep_next[id];
+	else
+		mt_sleep_next[prev] = mt_sleep_next[id];
+	mt_sleeping &= ~(1u << id);
+}
+
+int mt_lock() {
+#ifdef ENERGIA
+	return criticalEnter(MT_KERNEL_PRIORITY);
+#elif defined(__x86_64__)
+	return mt_host_int_disable();
+#endif
+}
+
+void mt_unlock(int oldLevel) {
+#ifdef ENERGIA
+	criticalExit(MT_KERNEL_PRIORITY, oldLevel);
+#elif defined(__x86_64__)
+	if (!oldLevel)
+		mt_host_int_enable();
+#endif
+}
+
+bool mt_in_isr() {
+#ifdef __ARM_ARCH_7EM__
+	return (HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_VEC_ACT_M) != 0;
+#elif defined(__x86_64__)
+	return mt_host_in_isr();
+#endif
+}
+
+static bool mt_wait_common(mt_wait_list_t * list, int oldLevel, bool timed, unsigned long deadline) {
+	const mt_scheduler_t * sched = mt_scheduler;
+	if (mt_in_isr()) {
+		mt_unlock(oldLevel);
+		return false;
+	}
+	if (!sched) {
+		/* no scheduler - the caller polls */
+		mt_unlock(oldLevel);
+		return true;
+	}
+	int id = sched->current_task();
+	if (id != MT_MAIN_TASK) {
+		if (list) {
+			*list |= (1u << id);
+			mt_waiting_on[id] = list;
+		}
+		if (timed)
+			mt_sleep_insert(id, deadline);
+		sched->block(id);
+	}
+	mt_unlock(oldLevel);
+	sched->wait();
+	return true;
+}
+
+bool mt_wait(mt_wait_list_t * list, int oldLevel) {
+	return mt_wait_common(list, oldLevel, false, 0);
+}
+
+bool mt_wait_until(mt_wait_list_t * list, int oldLevel, unsigned long deadline) {
+	return mt_wait_common(list, oldLevel, true, deadline);
+}
+
+int mt_wake_one(mt_wait_list_t * list) {
+	const mt_scheduler_t * sched = mt_scheduler;
+	unsigned int waiters = *list;
+	if (!waiters || !sched)
+		return -1;
+	/* highest priority waiter, the lowest id on ties */
+	int best = -1;
+	int best_priority = -1;
+	while (waiters) {
+		int id = __builtin_ctz(waiters);
+		waiters &= waiters - 1;
+		int priority = sched->task_priority(id);
+		if (priority > best_priority) {
+			best = id;
+			best_priority = priority;
+		}
+	}
+	*list &= ~(1u << best);
+	mt_waiting_on[best] = NULL;
+	mt_sleep_remove(best);
+	sched->wake(best);
+	return best;
+}
+
+void mt_wake_all(mt_wait_list_t * list) {
+	const mt_scheduler_t * sched = mt_scheduler;
+	unsigned int waiters = *list;
+	*list = 0;
+	if (!sched)
+		return;
+	while (waiters) {
+		int id = __builtin_ctz(waiters);
+		waiters &= waiters - 1;
+		mt_waiting_on[id] = NULL;
+		mt_sleep_remove(id);
+		sched->wake(id);
+	}
+}
+
+unsigned long mt_deadline(unsigned long timeout) {
+	return millis() + timeout;
+}
+
+bool mt_expired(unsigned long deadline) {
+	return (long) (millis() - deadline) >= 0;
+}
+
+/*
+ * Millisecond tick, called from the Timer5 interrupt handler.
+ * Wakes the tasks whose deadline has been reached.
+ */
+void mt_tick(unsigned long now) {
+	if (mt_sleep_head < 0)
+		return;
+	int oldLevel = mt_lock();
+	const mt_scheduler_t * sched = mt_scheduler;
+	while (mt_sleep_head >= 0 && (long) (now - mt_sleep_tick[mt_sleep_head]) >= 0) {
+		int id = mt_sleep_head;
+		mt_sleep_head = mt_sleep_next[id];
+		mt_sleeping &= ~(1u << id);
+		if (mt_waiting_on[id]) {
+			/* timed out */
+			*mt_waiting_on[id] &= ~(1u << id);
+			mt_waiting_on[id] = NULL;
+		}
+		if (sched)
+			sched->wake(id);
+	}
+	mt_unlock(oldLevel);
+}
+
+/*
+ * Wakes all the tasks of 'list', called by the drivers from interrupt
+ * handlers when an event occurs (Stream::notifyReaders()).
+ */
+void mt_notify(mt_wait_list_t * list) {
+	int oldLevel = mt_lock();
+	mt_wake_all(list);
+	mt_unlock(oldLevel);
+}
+
+/*
+ * Returns the milliseconds from 'now' to the next deadline of the sleep
+ * list, or 0xFFFFFFFF if no task sleeps. Called by timerSleep() so that
+ * the core does not sleep past a task deadline.
+ */
+unsigned long mt_next_tick(unsigned long now) {
+	if (mt_sleep_head < 0)
+		return 0xFFFFFFFF;
+	long left = (long) (mt_sleep_tick[mt_sleep_head] - now);
+	return left > 0 ? left : 0;
+}
+
+void mt_idle() {
+#ifdef ENERGIA
+	/* BASEPRI does not let the masked interrupts wake up WFI: sleep with
+	 * PRIMASK, the interrupt runs when the caller unlocks */
+	int primask = ROM_IntMasterDisable();
+	timerSleep(mt_next_tick(millis()));
+	if (!primask)
+		ROM_IntMasterEnable();
+#else
+	timerSleep(mt_next_tick(millis()));
+#endif
+}
+
+void task_sleep_until(unsigned long tick) {
+	int oldLevel = mt_lock();
+	while (!mt_expired(tick)) {
+		if (!mt_wait_until(NULL, oldLevel, tick))
+			return;
+		oldLevel = mt_lock();
+	}
+	mt_unlock(oldLevel);
+}
+
+void task_sleep(unsigned long ms) {
+	task_sleep_until(mt_deadline(ms));
+}
+
+/*
+ * delay() replacement, called by the core.
+ * Returns true if the current task was put to sleep, or false if the
+ * caller must do a busy wait (no scheduler, MAIN task or interrupt).
+ */
+int mt_delay(uint32_t ms) {
+	const mt_scheduler_t * sched = mt_scheduler;
+	if (!sched || mt_in_isr())
+		return false;
+	int oldLevel = mt_lock();
+	int id = sched->current_task();
+	mt_unlock(oldLevel);
+	if (id == MT_MAIN_TASK)
+		return false;
+	task_sleep(ms);
+	return true;
+}
@@ -0,0 +1,140 @@
+/******************************************
+ * StackPool.cpp
+ * Task stack allocator for the Multitask schedulers.
+ ******************************************
+ Copyright (c) 2014 Jose Ferreira
+
+ This library is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library.
+ If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+
+#ifdef ENERGIA
+
+#include "Energia.h"
+#include "utility/StackPool.h"
+
+#else
+
+#include "StackPool.h"
+
+#endif
+
+/*
+ * Every block starts with a header rounded up to MT_STACK_ALIGN bytes, so
+ * the memory after it keeps the pool alignment. Free blocks are kept in a list sorted
+ * by address, and merged with their neighbours when released.
+ */
+typedef struct mt_block {
+	unsigned int size;          /* block size, header included */
+	struct mt_block * next;     /* next free block (free blocks only) */
+} mt_block_t;
+
+#define MT_BLOCK_HEADER  ((sizeof(mt_block_t) + MT_STACK_ALIGN - 1) & ~(MT_STACK_ALIGN - 1))
+
+#ifdef ENERGIA
+static unsigned long long mt_stack_pool[MT_STACK_POOL_SIZE / sizeof(unsigned long long)]
+	__attribute__((section(".mtstack"), aligned(MT_STACK_ALIGN)));
+#else
+static unsigned long long mt_stack_pool[MT_STACK_POOL_SIZE / sizeof(unsigned long long)]
+	__attribute__((aligned(MT_STACK_ALIGN)));
+#endif
+
+static mt_block_t * mt_free_list = NULL;
+static bool mt_pool_initialized = false;
+
+static void mt_stack_pool_init() {
+	mt_free_list = (mt_block_t *) mt_stack_pool;
+	mt_free_list->size = sizeof(mt_stack_pool);
+	mt_free_list->next = NULL;
+	mt_pool_initialized = true;
+}
+
+void * mt_stack_alloc(int size) {
+	if (!mt_pool_initialized)
+		mt_stack_pool_init();
+	if (size < MT_MIN_STACK_SIZE)
+		size = MT_MIN_STACK_SIZE;
+	unsigned int need = ((size + MT_STACK_ALIGN - 1) & ~(MT_STACK_ALIGN - 1)) + MT_BLOCK_HEADER;
+	/* first fit */
+	mt_block_t ** link = &mt_free_list;
+	while (*link && (*link)->size < need)
+		link = &(*link)->next;
+	mt_block_t * block = *link;
+	if (!block)
+		return NULL;
+	if (block->size - need >= MT_MIN_STACK_SIZE + MT_BLOCK_HEADER) {
+		/* split: the tail of the block stays free */
+		mt_block_t * rest = (mt_block_t *) ((char *) block + need);
+		rest->size = block->size - need;
+		rest->next = block->next;
+		*link = rest;
+		block->size = need;
+	} else {
+		*link = block->next;
+	}
+	return (char *) block + MT_BLOCK_HEADER;
+}
+
+void mt_stack_free(void * stack) {
+	if (!stack)
+		return;
+	mt_block_t * block = (mt_block_t *) ((char *) stack - MT_BLOCK_HEADER);
+	mt_block_t * prev = NULL;
+	mt_block_t * next = mt_free_list;
+	while (next && next < block) {
+		prev = next;
+		next = next->next;
+	}
+	/* merge with the following block */
+	if (next && (char *) block + block->size == (char *) next) {
+		block->size += next->size;
+		block->next = next->next;
+	} else {
+		block->next = next;
+	}
+	/* merge with the preceding block */
+	if (prev && (char *) prev + prev->size == (char *) block) {
+		prev->size += block->size;
+		prev->next = block->next;
+	} else if (prev) {
+		prev->next = block;
+	} else {
+		mt_free_list = block;
+	}
+}
+
+int mt_stack_available() {
+	if (!mt_pool_initialized)
+		mt_stack_pool_init();
+	int total = 0;
+	for (mt_block_t * block = mt_free_list; block; block = block->next)
+		total += block->size - MT_BLOCK_HEADER;
+	return total;
+}
+
+void mt_stack_paint(void * stack, int size) {
+	unsigned int * word = (unsigned int *) stack;
+	for (int n = size / sizeof(unsigned int); n > 0; n--)
+		*word++ = MT_STACK_CANARY;
+}
+
+int mt_stack_unused(const void * stack, int size) {
+	const unsigned int * word = (const unsigned int *) stack;
+	const unsigned int * end = word + size / sizeof(unsigned int);
+	while (word < end && *word == MT_STACK_CANARY)
+		word++;
+	return (const char *) word - (const char *) stack;
+}
@@ -0,0 +1,177 @@
+/******************************************
+ * TaskStats.cpp
+ * Run time accounting for the Multitask schedulers.
+ ******************************************
+ Copyright (c) 2014 Jose Ferreira
+
+ This library is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library.
+ If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#ifdef ENERGIA
+
+#include "Energia.h"
+#include "inc/hw_memmap.h"
+#include "utility/TaskStats.h"
+
+#elif defined(__x86_64__)
+
+#include "HostPort.h"
+#include "TaskStats.h"
+
+#else
+
+#include "TaskStats.h"
+
+#error "Unsupported arch for the Multitask library"
+
+#endif
+
+/* cycle count of the last switch */
+static unsigned long long mt_last_switch = 0;
+
+unsigned long long mt_cycles() {
+#ifdef __ARM_ARCH_7EM__
+	return cycles64();
+#elif defined(__x86_64__)
+	return mt_host_nanos();
+#endif
+}
+
+void mt_stats_init(mt_task_stats_t * stats) {
+	stats->cycles = 0;
+	stats->switches = 0;
+	stats->max_latency = 0;
+	stats->ready_at = 0;
+	stats->waking = 0;
+}
+
+void mt_stats_start() {
+	/* cycles64() runs since timerInit() */
+	mt_last_switch = mt_cycles();
+}
+
+void mt_stats_switch(mt_task_stats_t * prev, mt_task_stats_t * next) {
+	unsigned long long now = mt_cycles();
+	prev->cycles += now - mt_last_switch;
+	mt_last_switch = now;
+	if (next == prev)
+		return;
+	next->switches++;
+	if (next->waking) {
+		unsigned int latency = (unsigned int) (now - next->ready_at);
+		if (latency > next->max_latency)
+			next->max_latency = latency;
+		next->waking = 0;
+	}
+}
+
+void mt_stats_ready(mt_task_stats_t * stats) {
+	stats->ready_at = mt_cycles();
+	stats->waking = 1;
+}
+
+unsigned long long mt_stats_runtime(const mt_task_stats_t * stats) {
+	return stats->cycles + (mt_cycles() - mt_last_switch);
+}
+
+void mt_periodic_init(mt_periodic_stats_t * stats) {
+	memset(stats, 0, sizeof(*stats));
+}
+
+static void mt_hist_add(unsigned int * hist, unsigned int us) {
+	int n = us ? 32 - __builtin_clz(us) : 0;
+	if (n >= MT_HIST_BUCKETS)
+		n = MT_HIST_BUCKETS - 1;
+	hist[n]++;
+}
+
+void mt_periodic_record(mt_periodic_stats_t * stats, unsigned int jitter, unsigned int exec, bool missed) {
+	jitter /= F_CPU / 1000000;
+	exec /= F_CPU / 1000000;
+	stats->releases++;
+	if (missed)
+		stats->misses++;
+	if (jitter > stats->max_jitter)
+		stats->max_jitter = jitter;
+	if (exec > stats->max_exec)
+		stats->max_exec = exec;
+	mt_hist_add(stats->jitter, jitter);
+	mt_hist_add(stats->exec, exec);
+}
+
+/*
+ * Prints the non empty buckets of a histogram, as "<limit:count".
+ */
+static void mt_hist_print(Print & out, const char * name, const unsigned int * hist) {
+	out.print(name);
+	for (int n = 0; n < MT_HIST_BUCKETS; n++) {
+		if (!hist[n])
+			continue;
+		out.print(n == MT_HIST_BUCKETS - 1 ? " >=" : " <");
+		out.print(1UL << (n == MT_HIST_BUCKETS - 1 ? n - 1 : n));
+		out.print(':');
+		out.print(hist[n]);
+	}
+	out.println();
+}
+
+void mt_periodic_print(Print & out, int id, unsigned long period_us, const mt_periodic_stats_t * stats) {
+	out.print("task ");
+	out.print(id);
+	out.print(": period ");
+	out.print(period_us);
+	out.print("us, releases ");
+	out.print(stats->releases);
+	out.print(", misses ");
+	out.print(stats->misses);
+	out.print(", max jitter ");
+	out.print(stats->max_jitter);
+	out.print("us, max exec ");
+	out.print(stats->max_exec);
+	out.println("us");
+	mt_hist_print(out, "  jitter(us)", stats->jitter);
+	mt_hist_print(out, "  exec(us)  ", stats->exec);
+}
+
+void mt_stats_print_header(Print & out) {
+	out.println("task\tprio\tcpu%\tswitches\tmax lat(us)\tstack\tfree");
+}
+
+void mt_stats_print(Print & out, int id, int priority, const mt_task_stats_t * stats,
+		unsigned long long total, int stack_size, int unused) {
+	/* percentage with one decimal */
+	unsigned int permille = total ? (unsigned int) (stats->cycles * 1000 / total) : 0;
+	out.print(id);
+	out.print('\t');
+	out.print(priority);
+	out.print('\t');
+	out.print(permille / 10);
+	out.print('.');
+	out.print(permille % 10);
+	out.print('\t');
+	out.print(stats->switches);
+	out.print("\t\t");
+	out.print(stats->max_latency / (F_CPU / 1000000));
+	out.print("\t\t");
+	if (unused < 0) {
+		out.println("-\t-");
+		return;
+	}
+	out.print(stack_size);
+	out.print('\t');
+	out.println(unused);
+}
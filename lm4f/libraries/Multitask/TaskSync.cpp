@@ -0,0 +1,193 @@
+/******************************************
+ * TaskSync.cpp
+ * Blocking synchronization primitives for the Multitask schedulers.
+ ******************************************
+ Copyright (c) 2014 Jose Ferreira
+
+ This library is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library.
+ If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef ENERGIA
+
+#include "Energia.h"
+#include "utility/TaskSync.h"
+
+#elif defined(__x86_64__)
+
+#include "HostPort.h"
+#include "TaskSync.h"
+
+#else
+
+#include "TaskSync.h"
+
+#endif
+
+/*
+ * Create a semaphore with 'initial' units available, up to 'max'.
+ */
+Semaphore::Semaphore(int initial, int max) {
+	count = initial;
+	max_count = max;
+	waiters = 0;
+}
+
+/*
+ * Takes one unit, waiting up to 'timeout' milliseconds while none is
+ * available.
+ * Returns false if no unit is available after the timeout, or if the
+ * caller can not wait.
+ */
+bool Semaphore::take(unsigned long timeout) {
+	unsigned long deadline = mt_deadline(timeout);
+	int oldLevel = mt_lock();
+	while (count <= 0) {
+		if (timeout != MT_FOREVER && mt_expired(deadline)) {
+			mt_unlock(oldLevel);
+			return false;
+		}
+		if (timeout == MT_FOREVER ? !mt_wait(&waiters, oldLevel) : !mt_wait_until(&waiters, oldLevel, deadline))
+			return false;
+		oldLevel = mt_lock();
+	}
+	count--;
+	mt_unlock(oldLevel);
+	return true;
+}
+
+/*
+ * Takes one unit if available.
+ */
+bool Semaphore::tryTake() {
+	bool ret = false;
+	int oldLevel = mt_lock();
+	if (count > 0) {
+		count--;
+		ret = true;
+	}
+	mt_unlock(oldLevel);
+	return ret;
+}
+
+/*
+ * Releases one unit and wakes the highest priority waiter.
+ */
+void Semaphore::give() {
+	int oldLevel = mt_lock();
+	if (count < max_count)
+		count++;
+	mt_wake_one(&waiters);
+	mt_unlock(oldLevel);
+}
+
+/*
+ * Releases one unit from an interrupt handler.
+ * The woken task runs when the handler returns.
+ */
+void Semaphore::giveFromISR() {
+	give();
+}
+
+int Semaphore::available() {
+	return count;
+}
+
+bool waitReadable(Stream & stream, unsigned long timeout) {
+	unsigned long deadline = mt_deadline(timeout);
+	mt_wait_list_t * readers = stream.readers();
+	int oldLevel = mt_lock();
+	while (stream.available() <= 0) {
+		if (timeout != MT_FOREVER && mt_expired(deadline)) {
+			mt_unlock(oldLevel);
+			return false;
+		}
+		const mt_scheduler_t * sched = mt_scheduler;
+		bool blocked = sched && sched->current_task() != MT_MAIN_TASK;
+		if (timeout == MT_FOREVER ? !mt_wait(readers, oldLevel) : !mt_wait_until(readers, oldLevel, deadline))
+			return false;
+		if (blocked) {
+			/* woken by the driver, or timed out */
+			return stream.available() > 0;
+		}
+		oldLevel = mt_lock();
+	}
+	mt_unlock(oldLevel);
+	return true;
+}
+
+Mutex::Mutex() {
+	owner = -1;
+	waiters = 0;
+}
+
+/*
+ * Locks the mutex, waiting up to 'timeout' milliseconds while another
+ * task owns it.
+ * Returns false if the mutex is still owned after the timeout.
+ */
+bool Mutex::lock(unsigned long timeout) {
+	unsigned long deadline = mt_deadline(timeout);
+	int oldLevel = mt_lock();
+	const mt_scheduler_t * sched = mt_scheduler;
+	int id = sched ? sched->current_task() : MT_MAIN_TASK;
+	while (owner >= 0) {
+		if (timeout != MT_FOREVER && mt_expired(deadline)) {
+			mt_unlock(oldLevel);
+			return false;
+		}
+		if (timeout == MT_FOREVER ? !mt_wait(&waiters, oldLevel) : !mt_wait_until(&waiters, oldLevel, deadline))
+			return false;
+		oldLevel = mt_lock();
+	}
+	owner = id;
+	mt_unlock(oldLevel);
+	return true;
+}
+
+/*
+ * Locks the mutex if no task owns it.
+ */
+bool Mutex::tryLock() {
+	bool ret = false;
+	int oldLevel = mt_lock();
+	if (owner < 0) {
+		const mt_scheduler_t * sched = mt_scheduler;
+		owner = sched ? sched->current_task() : MT_MAIN_TASK;
+		ret = true;
+	}
+	mt_unlock(oldLevel);
+	return ret;
+}
+
+/*
+ * Unlocks the mutex and wakes the highest priority waiter.
+ * Returns false, leaving the mutex locked, if the calling task does
+ * not own it or if called from an interrupt handler.
+ */
+bool Mutex::unlock() {
+	if (mt_in_isr())
+		return false;
+	int oldLevel = mt_lock();
+	const mt_scheduler_t * sched = mt_scheduler;
+	int id = sched ? sched->current_task() : MT_MAIN_TASK;
+	if (owner != id) {
+		mt_unlock(oldLevel);
+		return false;
+	}
+	owner = -1;
+	mt_wake_one(&waiters);
+	mt_unlock(oldLevel);
+	return true;
+}
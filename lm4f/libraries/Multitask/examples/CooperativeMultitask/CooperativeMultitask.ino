@@ -1,13 +1,5 @@
 #include <Multitask.h>
 
-/* modified delay to call cmt_yeld() */
-void delay_sleep(unsigned long interval)
-{
-  unsigned long start = millis();
-  while(millis() - start < interval)
-    cmt_yeld();
-}
-
 void loop1()
 {
   int led = D1_LED;
@@ -17,9 +9,9 @@ void loop1()
   while(--timeout)
   {
     digitalWrite(led, HIGH);
-    delay_sleep(1000);
+    delay(1000);
     digitalWrite(led, LOW);
-    delay_sleep(1000);
+    delay(1000);
   }
   Serial.println("[loop1 END]");
 }
@@ -33,9 +25,9 @@ void loop2()
   while(--timeout)
   {
     digitalWrite(led, HIGH);
-    delay_sleep(300);
+    delay(300);
     digitalWrite(led, LOW);
-    delay_sleep(300);
+    delay(300);
   }
   Serial.println("[loop2 END]");
 }
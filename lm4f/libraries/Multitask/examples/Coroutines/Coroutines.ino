@@ -0,0 +1,108 @@
+#include <Multitask.h>
+
+/*
+ * Blinks a LED with a stackless coroutine.
+ * The state that survives CO_DELAY() is kept in members.
+ */
+class Blink : public Coroutine
+{
+public:
+  int led;
+  unsigned long period;
+  int count;
+
+  Blink(int led, unsigned long period) : led(led), period(period) {}
+
+  char run()
+  {
+    CO_BEGIN();
+    pinMode(led, OUTPUT);
+    for (count = 0; count < 20; count++)
+    {
+      digitalWrite(led, HIGH);
+      CO_DELAY(period);
+      digitalWrite(led, LOW);
+      CO_DELAY(period);
+    }
+    Serial.println("[blink END]");
+    CO_END();
+  }
+};
+
+/*
+ * Echoes the lines received on the serial port, until "quit".
+ */
+class Echo : public Coroutine
+{
+public:
+  char line[32];
+  int len;
+
+  char run()
+  {
+    CO_BEGIN();
+    for (;;)
+    {
+      len = 0;
+      do
+      {
+        CO_WAIT_UNTIL(Serial.available());
+        line[len] = Serial.read();
+      } while (line[len] != '\n' && ++len < (int) sizeof(line) - 1);
+      line[len] = 0;
+      if (strcmp(line, "quit") == 0)
+        CO_EXIT();
+      Serial.print("echo: ");
+      Serial.println(line);
+    }
+    CO_END();
+  }
+};
+
+Blink blink1(D1_LED, 1000);
+Blink blink2(D2_LED, 300);
+Echo echo;
+CoroutineScheduler coroutines;
+
+/*
+ * The coroutines share a task of the cooperative scheduler with a small
+ * stack, and yeld to the other tasks between two rounds.
+ */
+void coroutineTask()
+{
+  coroutines.add(blink1);
+  coroutines.add(blink2);
+  coroutines.add(echo);
+  coroutines.run();
+}
+
+void counterTask()
+{
+  for (int n = 0; n < 10; n++)
+  {
+    Serial.print("[counter ");
+    Serial.print(n);
+    Serial.println("]");
+    delay(2000);
+  }
+}
+
+CooperativeScheduler tasker;
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println("Serial console initialized");
+
+  tasker.begin();
+  tasker.create_task(coroutineTask);
+  tasker.create_task(counterTask);
+
+  Serial.println("[run tasks BEGIN]");
+  tasker.run();
+  Serial.println("[run tasks END]");
+}
+
+void loop()
+{
+}
@@ -0,0 +1,55 @@
+#include <Multitask.h>
+
+PreemptiveScheduler tasker;
+int currentLoop;
+int sensorLoop;
+
+/*
+ * 1kHz job: the shorter period gets the higher priority.
+ */
+void currentJob()
+{
+  analogRead(A0);
+}
+
+/*
+ * 100Hz job.
+ */
+void sensorJob()
+{
+  analogRead(A1);
+  analogRead(A2);
+}
+
+/*
+ * Prints the jitter and execution time histograms every 5 seconds.
+ */
+void reportTask()
+{
+  for (int n = 0; n < 12; n++)
+  {
+    delay(5000);
+    tasker.printPeriodicStats(Serial);
+  }
+  tasker.stop_periodic(currentLoop);
+  tasker.stop_periodic(sensorLoop);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println("Serial console initialized");
+
+  tasker.begin();
+  currentLoop = tasker.create_periodic(currentJob, 1000, MT_DEFAULT_PRIORITY + 2);
+  sensorLoop = tasker.create_periodic(sensorJob, 10000, MT_DEFAULT_PRIORITY + 1);
+  tasker.create_task(reportTask);
+
+  Serial.println("[run tasks BEGIN]");
+  tasker.run();
+  Serial.println("[run tasks END]");
+}
+
+void loop()
+{
+}
@@ -0,0 +1,307 @@
+/******************************************
+ * HostPort.cpp
+ * Linux x86-64 port of the Multitask library.
+ ******************************************
+ Copyright (c) 2014 Jose Ferreira
+
+ This library is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library.
+ If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include "HostPort.h"
+
+/* hooks of the Multitask library, as in wiring.c */
+extern "C" void mt_tick(unsigned long now) __attribute__((weak));
+extern "C" int mt_delay(uint32_t ms) __attribute__((weak));
+
+static sigset_t mt_host_alarm;
+static struct timespec mt_host_start;
+
+static volatile int mt_host_isr_depth = 0;
+static volatile int mt_host_wfi = 0;       /* in timerSleep(): no PendSV until enabled */
+static volatile int mt_host_pendsv_pending = 0;
+static void (*volatile mt_host_pendsv)() = NULL;
+
+static void (*volatile mt_host_timer_isr)() = NULL;
+static volatile unsigned long mt_host_timer_period = 0;
+static volatile unsigned long mt_host_timer_count = 0;
+
+static void (*volatile mt_host_oneshot_isr)() = NULL;
+static timer_t mt_host_oneshot;
+
+/*
+ * Runs the PendSV handler while a switch is pending.
+ * The handler may switch to another context: this one resumes here
+ * when it is switched back in.
+ */
+static void mt_host_dispatch() {
+	sigset_t old;
+	sigprocmask(SIG_BLOCK, &mt_host_alarm, &old);
+	while (mt_host_pendsv_pending) {
+		mt_host_pendsv_pending = 0;
+		if (mt_host_pendsv)
+			mt_host_pendsv();
+	}
+	sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+/*
+ * SIGALRM handler: the millisecond tick.
+ */
+static void mt_host_tick(int sig) {
+	mt_host_isr_depth++;
+	if (mt_tick)
+		mt_tick(millis());
+	if (mt_host_timer_isr && ++mt_host_timer_count >= mt_host_timer_period) {
+		mt_host_timer_count = 0;
+		mt_host_timer_isr();
+	}
+	mt_host_isr_depth--;
+	/* tail-chained PendSV, unless the tick woke up timerSleep() */
+	if (!mt_host_wfi)
+		mt_host_dispatch();
+}
+
+/*
+ * SIGRTMIN handler: the one-shot timer.
+ */
+static void mt_host_oneshot_tick(int sig) {
+	void (*isr)() = mt_host_oneshot_isr;
+	mt_host_isr_depth++;
+	mt_host_oneshot_isr = NULL;
+	if (isr)
+		isr();
+	mt_host_isr_depth--;
+	if (!mt_host_wfi)
+		mt_host_dispatch();
+}
+
+void timerInit(void) {
+	sigemptyset(&mt_host_alarm);
+	sigaddset(&mt_host_alarm, SIGALRM);
+	sigaddset(&mt_host_alarm, SIGRTMIN);
+	clock_gettime(CLOCK_MONOTONIC, &mt_host_start);
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = mt_host_tick;
+	action.sa_flags = SA_RESTART;
+	action.sa_mask = mt_host_alarm;
+	sigaction(SIGALRM, &action, NULL);
+	action.sa_handler = mt_host_oneshot_tick;
+	sigaction(SIGRTMIN, &action, NULL);
+
+	struct sigevent event;
+	memset(&event, 0, sizeof(event));
+	event.sigev_notify = SIGEV_SIGNAL;
+	event.sigev_signo = SIGRTMIN;
+	timer_create(CLOCK_MONOTONIC, &event, &mt_host_oneshot);
+
+	struct itimerval timer;
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_usec = 1000;
+	timer.it_value = timer.it_interval;
+	setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+unsigned long micros(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - mt_host_start.tv_sec) * 1000000UL + (now.tv_nsec - mt_host_start.tv_nsec) / 1000;
+}
+
+unsigned long millis(void) {
+	return micros() / 1000;
+}
+
+unsigned long long mt_host_nanos() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void delay(uint32_t ms) {
+	if (mt_delay && mt_delay(ms))
+		return;
+	unsigned long start = millis();
+	while (millis() - start < ms) {
+	}
+}
+
+/*
+ * WFI: called with SIGALRM blocked, returns after the next tick.
+ * The tick is not suppressed on the host.
+ */
+void timerSleep(uint32_t ms) {
+	sigset_t wait;
+	sigprocmask(SIG_BLOCK, NULL, &wait);
+	sigdelset(&wait, SIGALRM);
+	sigdelset(&wait, SIGRTMIN);
+	mt_host_wfi = 1;
+	sigsuspend(&wait);
+	mt_host_wfi = 0;
+}
+
+int mt_host_int_disable() {
+	sigset_t old;
+	sigprocmask(SIG_BLOCK, &mt_host_alarm, &old);
+	return sigismember(&old, SIGALRM);
+}
+
+void mt_host_int_enable() {
+	sigprocmask(SIG_UNBLOCK, &mt_host_alarm, NULL);
+	if (mt_host_pendsv_pending && !mt_host_isr_depth)
+		mt_host_dispatch();
+}
+
+bool mt_host_int_disabled() {
+	sigset_t mask;
+	sigprocmask(SIG_BLOCK, NULL, &mask);
+	return sigismember(&mask, SIGALRM);
+}
+
+bool mt_host_in_isr() {
+	return mt_host_isr_depth > 0;
+}
+
+void mt_host_set_pendsv(void (*handler)()) {
+	mt_host_pendsv = handler;
+}
+
+void mt_host_request_pendsv() {
+	mt_host_pendsv_pending = 1;
+	if (!mt_host_isr_depth && !mt_host_int_disabled())
+		mt_host_dispatch();
+}
+
+void mt_host_timer_start(void (*isr)(), unsigned long period) {
+	int oldLevel = mt_host_int_disable();
+	mt_host_timer_count = 0;
+	mt_host_timer_period = period;
+	mt_host_timer_isr = isr;
+	if (!oldLevel)
+		mt_host_int_enable();
+}
+
+void mt_host_timer_stop() {
+	mt_host_timer_isr = NULL;
+}
+
+void mt_host_oneshot_start(void (*isr)(), unsigned int ns) {
+	struct itimerspec timer;
+	int oldLevel = mt_host_int_disable();
+	memset(&timer, 0, sizeof(timer));
+	if (isr) {
+		/* a zero it_value would disarm the timer */
+		ns = ns ? ns : 1;
+		timer.it_value.tv_sec = ns / 1000000000;
+		timer.it_value.tv_nsec = ns % 1000000000;
+	}
+	mt_host_oneshot_isr = isr;
+	timer_settime(mt_host_oneshot, 0, &timer, NULL);
+	if (!oldLevel)
+		mt_host_int_enable();
+}
+
+/*
+ * Print
+ */
+Print Serial;
+
+extern "C" void mt_notify(volatile unsigned int * list) __attribute__((weak));
+
+void Stream::notifyReaders(volatile unsigned int * readers) {
+	if (*readers && mt_notify)
+		mt_notify(readers);
+}
+
+size_t Print::write(uint8_t c) {
+	return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t Print::print(const char * s) {
+	size_t n = 0;
+	while (*s)
+		n += write((uint8_t) *s++);
+	return n;
+}
+
+size_t Print::print(char c) {
+	return write((uint8_t) c);
+}
+
+size_t Print::print(int n, int base) {
+	return print((long) n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+	return print((unsigned long) n, base);
+}
+
+size_t Print::print(long n, int base) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), base == DEC ? "%ld" : "%lx", n);
+	return print(buf);
+}
+
+size_t Print::print(unsigned long n, int base) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), base == DEC ? "%lu" : "%lx", n);
+	return print(buf);
+}
+
+size_t Print::print(double n, int digits) {
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%.*f", digits, n);
+	return print(buf);
+}
+
+size_t Print::println(void) {
+	return print('\n');
+}
+
+size_t Print::println(const char * s) {
+	size_t n = print(s);
+	return n + println();
+}
+
+size_t Print::println(int n, int base) {
+	size_t ret = print(n, base);
+	return ret + println();
+}
+
+size_t Print::println(unsigned int n, int base) {
+	size_t ret = print(n, base);
+	return ret + println();
+}
+
+size_t Print::println(long n, int base) {
+	size_t ret = print(n, base);
+	return ret + println();
+}
+
+size_t Print::println(unsigned long n, int base) {
+	size_t ret = print(n, base);
+	return ret + println();
+}
+
+size_t Print::println(double n, int digits) {
+	size_t ret = print(n, digits);
+	return ret + println();
+}
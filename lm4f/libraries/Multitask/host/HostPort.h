@@ -0,0 +1,133 @@
+/*
+ * HostPort.h
+ *
+ * Linux x86-64 port of the Multitask library, to run the schedulers and
+ * their benchmark on a PC.
+ * It provides the part of the Energia core used by the library, and
+ * emulates the interrupts with SIGALRM:
+ * - interrupts disabled: SIGALRM blocked
+ * - millisecond tick (Timer5) and switch tick (Timer4): SIGALRM, each ms
+ * - PendSV: a pending flag, serviced when SIGALRM gets unblocked or at
+ *   the end of the SIGALRM handler
+ * - release timer of the periodic tasks: a POSIX timer raising SIGRTMIN,
+ *   blocked and unblocked together with SIGALRM
+ */
+
+#ifndef HOSTPORT_H_
+#define HOSTPORT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define F_CPU  1000000000UL   /* the host cycle counter counts nanoseconds */
+
+#define DEC 10
+#define HEX 16
+
+/* no trace buffer on the host */
+#define TRACE(event, arg)
+
+extern "C" {
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(uint32_t ms);
+void timerInit(void);
+void timerSleep(uint32_t ms);
+int deferWork(void (*work)(uint32_t), uint32_t arg);
+void runDeferredWork(void);
+void registerDeferredWorker(void (*wake)(void));
+int hasDeferredWorker(void);
+}
+
+/*
+ * Blocks SIGALRM.
+ * Returns true if it was already blocked.
+ */
+int mt_host_int_disable();
+
+/*
+ * Unblocks SIGALRM, and runs the PendSV handler if a switch is pending.
+ */
+void mt_host_int_enable();
+
+/*
+ * Returns true if SIGALRM is blocked.
+ */
+bool mt_host_int_disabled();
+
+/*
+ * Returns true inside the SIGALRM handler.
+ */
+bool mt_host_in_isr();
+
+/*
+ * Installs the PendSV handler, run with SIGALRM blocked.
+ */
+void mt_host_set_pendsv(void (*handler)());
+
+/*
+ * Pends the PendSV handler.
+ */
+void mt_host_request_pendsv();
+
+/*
+ * Calls 'isr' from the SIGALRM handler every 'period' milliseconds.
+ */
+void mt_host_timer_start(void (*isr)(), unsigned long period);
+void mt_host_timer_stop();
+
+/*
+ * Calls 'isr' from the SIGRTMIN handler once, after 'ns' nanoseconds.
+ * A new call replaces the pending one, 'isr' NULL cancels it.
+ */
+void mt_host_oneshot_start(void (*isr)(), unsigned int ns);
+
+/*
+ * Returns the monotonic clock in nanoseconds.
+ */
+unsigned long long mt_host_nanos();
+
+/*
+ * Minimal Print, writing to the standard output.
+ */
+class Print {
+public:
+	virtual size_t write(uint8_t c);
+	size_t print(const char * s);
+	size_t print(char c);
+	size_t print(int n, int base = DEC);
+	size_t print(unsigned int n, int base = DEC);
+	size_t print(long n, int base = DEC);
+	size_t print(unsigned long n, int base = DEC);
+	size_t print(double n, int digits = 2);
+	size_t println(void);
+	size_t println(const char * s);
+	size_t println(int n, int base = DEC);
+	size_t println(unsigned int n, int base = DEC);
+	size_t println(long n, int base = DEC);
+	size_t println(unsigned long n, int base = DEC);
+	size_t println(double n, int digits = 2);
+	virtual ~Print() {
+	}
+};
+
+extern Print Serial;
+
+/*
+ * Minimal Stream: the readers wait list of waitReadable().
+ */
+class Stream : public Print {
+protected:
+	volatile unsigned int _readers;
+public:
+	Stream() : _readers(0) {
+	}
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual volatile unsigned int * readers() {
+		return &_readers;
+	}
+	static void notifyReaders(volatile unsigned int * readers);
+};
+
+#endif /* HOSTPORT_H_ */
@@ -0,0 +1,347 @@
+/******************************************
+ * MultitaskBenchmark.cpp
+ * Scheduling benchmark of the Multitask library, for the host port.
+ * Reports the context switch latency, the yield throughput and the
+ * fairness of both schedulers, the yield throughput of coroutines and
+ * the timing of periodic tasks.
+ *
+ * Usage: multitask_benchmark [seconds per test]
+ ******************************************
+ Copyright (c) 2014 Jose Ferreira
+
+ This library is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Lesser General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library.
+ If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "HostPort.h"
+#include "CooperativeScheduler.h"
+#include "Coroutine.h"
+#include "PreemptiveScheduler.h"
+#include "SchedulerOps.h"
+#include "TaskSync.h"
+
+#define BENCH_TASKS        4
+#define BENCH_WAKE_ROUNDS  10000
+
+static CooperativeScheduler cooperative;
+static PreemptiveScheduler preemptive;
+
+static unsigned long bench_duration;    /* microseconds per test */
+static unsigned long bench_end;
+static void (*bench_yield)();
+static volatile unsigned long bench_counts[BENCH_TASKS];
+static volatile int bench_next_id;
+
+static Semaphore bench_sem;
+static volatile unsigned int bench_stamp;
+static volatile bool bench_waking_done;
+static unsigned long long bench_latency_sum;
+static unsigned int bench_latency_max;
+
+static void bench_start() {
+	for (int i = 0; i < BENCH_TASKS; i++)
+		bench_counts[i] = 0;
+	bench_next_id = 0;
+	bench_end = micros() + bench_duration;
+}
+
+static unsigned long bench_total() {
+	unsigned long total = 0;
+	for (int i = 0; i < BENCH_TASKS; i++)
+		total += bench_counts[i];
+	return total;
+}
+
+/*
+ * Yield test: each task counts its yields.
+ */
+static void yield_task() {
+	int id = bench_next_id++;
+	while ((long) (micros() - bench_end) < 0) {
+		bench_yield();
+		bench_counts[id]++;
+	}
+}
+
+/*
+ * Yield test of the stackless coroutines.
+ */
+class YieldCoroutine : public Coroutine {
+public:
+	int id;
+	char run() {
+		CO_BEGIN();
+		while ((long) (micros() - bench_end) < 0) {
+			CO_YIELD();
+			bench_counts[id]++;
+		}
+		CO_END();
+	}
+};
+
+static YieldCoroutine bench_coroutines[BENCH_TASKS];
+
+/*
+ * Fairness test: CPU bound tasks of the same priority, only preempted.
+ */
+static void spin_task() {
+	int id = bench_next_id++;
+	while ((long) (micros() - bench_end) < 0)
+		bench_counts[id]++;
+}
+
+/*
+ * Wake up test: a higher priority task waits on a semaphore given by a
+ * lower priority one, and measures the time until it runs.
+ */
+static void waiter_task() {
+	for (int n = 0; n < BENCH_WAKE_ROUNDS; n++) {
+		bench_sem.take();
+		unsigned int latency = mt_host_nanos() - bench_stamp;
+		bench_latency_sum += latency;
+		if (latency > bench_latency_max)
+			bench_latency_max = latency;
+	}
+	bench_waking_done = true;
+}
+
+static void giver_task() {
+	while (!bench_waking_done) {
+		bench_stamp = mt_host_nanos();
+		bench_sem.give();
+		bench_yield();
+	}
+}
+
+/*
+ * I/O wake test: the reader blocks in waitReadable(), the writer plays the
+ * receive interrupt handler of a driver.
+ */
+class BenchStream : public Stream {
+public:
+	volatile int count;
+	int available() {
+		return count;
+	}
+	int read() {
+		if (count <= 0)
+			return -1;
+		count--;
+		return 0;
+	}
+	void receive() {
+		int oldLevel = mt_lock();
+		count++;
+		notifyReaders(&_readers);
+		mt_unlock(oldLevel);
+	}
+};
+
+static BenchStream bench_stream;
+
+static void reader_task() {
+	for (int n = 0; n < BENCH_WAKE_ROUNDS; n++) {
+		waitReadable(bench_stream);
+		unsigned int latency = mt_host_nanos() - bench_stamp;
+		bench_stream.read();
+		bench_latency_sum += latency;
+		if (latency > bench_latency_max)
+			bench_latency_max = latency;
+	}
+	bench_waking_done = true;
+}
+
+static void writer_task() {
+	while (!bench_waking_done) {
+		if (!bench_stream.available()) {
+			bench_stamp = mt_host_nanos();
+			bench_stream.receive();
+		}
+		bench_yield();
+	}
+}
+
+/*
+ * Periodic task test: a 1kHz and a 100Hz job over a CPU bound background
+ * task, stopped after the test duration.
+ */
+static int bench_fast;
+static int bench_slow;
+
+static void spin_us(unsigned long us) {
+	unsigned long start = micros();
+	while (micros() - start < us) {
+	}
+}
+
+static void fast_job() {
+	spin_us(50);
+}
+
+static void slow_job() {
+	spin_us(2000);
+}
+
+static void background_task() {
+	while ((long) (micros() - bench_end) < 0) {
+	}
+	preemptive.printPeriodicStats(Serial);
+	preemptive.stop_periodic(bench_fast);
+	preemptive.stop_periodic(bench_slow);
+}
+
+/*
+ * Deferred work test: a low priority task posts work items, run by the
+ * worker task.
+ */
+static void deferred_work(uint32_t stamp) {
+	unsigned int latency = mt_host_nanos() - stamp;
+	bench_latency_sum += latency;
+	if (latency > bench_latency_max)
+		bench_latency_max = latency;
+}
+
+static void poster_task() {
+	for (int n = 0; n < BENCH_WAKE_ROUNDS; n++) {
+		while (!deferWork(deferred_work, mt_host_nanos()))
+			pmt_yield();
+	}
+}
+
+static void report_yield(const char * name) {
+	unsigned long total = bench_total();
+	double seconds = bench_duration / 1e6;
+	Serial.print(name);
+	Serial.print(" yield throughput: ");
+	Serial.print((unsigned long) (total / seconds));
+	Serial.print(" yields/s, ");
+	Serial.print(total ? bench_duration * 1000.0 / total : 0.0, 1);
+	Serial.println(" ns/switch");
+}
+
+static void report_fairness(const char * name) {
+	double sum = 0;
+	double squares = 0;
+	Serial.print(name);
+	Serial.print(" fairness: shares");
+	for (int i = 0; i < BENCH_TASKS; i++) {
+		double x = bench_counts[i];
+		sum += x;
+		squares += x * x;
+	}
+	for (int i = 0; i < BENCH_TASKS; i++) {
+		Serial.print(' ');
+		Serial.print(sum ? 100.0 * bench_counts[i] / sum : 0.0, 1);
+		Serial.print('%');
+	}
+	/* Jain's index: 1.0 when all the tasks got the same CPU time */
+	Serial.print(", Jain index ");
+	Serial.println(squares ? sum * sum / (BENCH_TASKS * squares) : 0.0, 3);
+}
+
+static void report_latency(const char * name) {
+	Serial.print(name);
+	Serial.print(" latency: avg ");
+	Serial.print((double) bench_latency_sum / BENCH_WAKE_ROUNDS, 0);
+	Serial.print(" ns, max ");
+	Serial.print(bench_latency_max);
+	Serial.println(" ns");
+}
+
+static void wake_start() {
+	bench_latency_sum = 0;
+	bench_latency_max = 0;
+	bench_waking_done = false;
+}
+
+int main(int argc, char * argv[]) {
+	double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+	bench_duration = (unsigned long) (seconds * 1e6);
+	timerInit();
+
+	/* cooperative scheduler */
+	bench_yield = cmt_yeld;
+	cooperative.begin();
+	for (int i = 0; i < BENCH_TASKS; i++)
+		cooperative.create_task(yield_task);
+	bench_start();
+	cooperative.run();
+	report_yield("cooperative");
+
+	cooperative.begin();
+	wake_start();
+	cooperative.create_task(waiter_task, MT_DEFAULT_PRIORITY + 1);
+	cooperative.create_task(giver_task);
+	cooperative.run();
+	report_latency("cooperative wake");
+
+	/* coroutines */
+	CoroutineScheduler coroutines;
+	for (int i = 0; i < BENCH_TASKS; i++) {
+		bench_coroutines[i].id = i;
+		coroutines.add(bench_coroutines[i]);
+	}
+	bench_start();
+	coroutines.run();
+	report_yield("coroutine");
+
+	/* preemptive scheduler */
+	bench_yield = pmt_yield;
+	preemptive.begin();
+	for (int i = 0; i < BENCH_TASKS; i++)
+		preemptive.create_task(yield_task);
+	bench_start();
+	preemptive.run();
+	report_yield("preemptive");
+
+	preemptive.begin();
+	for (int i = 0; i < BENCH_TASKS; i++)
+		preemptive.create_task(spin_task);
+	bench_start();
+	preemptive.run();
+	report_fairness("preemptive");
+
+	preemptive.begin();
+	wake_start();
+	preemptive.create_task(waiter_task, MT_DEFAULT_PRIORITY + 1);
+	preemptive.create_task(giver_task);
+	preemptive.run();
+	report_latency("preemptive wake");
+
+	preemptive.begin();
+	wake_start();
+	preemptive.create_task(reader_task, MT_DEFAULT_PRIORITY + 1);
+	preemptive.create_task(writer_task);
+	preemptive.run();
+	report_latency("preemptive I/O wake");
+
+	preemptive.begin();
+	bench_fast = preemptive.create_periodic(fast_job, 1000, MT_DEFAULT_PRIORITY + 2);
+	bench_slow = preemptive.create_periodic(slow_job, 10000, MT_DEFAULT_PRIORITY + 1);
+	preemptive.create_task(background_task);
+	bench_start();
+	Serial.println("preemptive periodic tasks:");
+	preemptive.run();
+
+	preemptive.begin();
+	wake_start();
+	preemptive.create_worker();
+	preemptive.create_task(poster_task);
+	preemptive.run();
+	report_latency("preemptive deferred work");
+
+	return 0;
+}
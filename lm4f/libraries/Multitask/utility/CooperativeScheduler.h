@@ -9,16 +9,27 @@
 #define COOPERATIVE_SCHEDULER_H_
 
 #include <setjmp.h>
+#include "ReadyQueue.h"
+#include "StackPool.h"
+#include "TaskStats.h"
 
 /* Cooperative scheduler configuration */
-#define CMT_MAX_TASKS           8
+#define CMT_MAX_TASKS          16
+#ifdef __x86_64__
+#define CMT_STACK_SIZE      16384   /* the SIGALRM frames of the host port land on the task stacks */
+#else
 #define CMT_STACK_SIZE       2048
-#define CMT_PREALLOC_STACK      1
+#endif
+
+#if CMT_MAX_TASKS > MT_QUEUE_SIZE
+#error "CMT_MAX_TASKS must not be greater than MT_QUEUE_SIZE"
+#endif
 
 /* constants */
 #define CMT_STATUS_FREE     0
 #define CMT_STATUS_CREATED  1
 #define CMT_STATUS_READY    2
+#define CMT_STATUS_BLOCKED  3   /* waiting, out of the ready queue */
 #define CMT_MAIN_TASK       0   /* MAIN task must be task 0 */
 
 #if defined(__ARM_ARCH_7EM__)
@@ -31,21 +42,51 @@
 #define CMT_CPU_REG_SP      7   /* setjmp register #7 contains ESP */
 #define CMT_CPU_REG_PC      8   /* setjmp register #8 contains EIP */
 
+#elif defined(__x86_64__) && defined(__GLIBC__)
+
+#define CMT_CPU_REG_SP      6   /* setjmp register #6 contains RSP */
+#define CMT_CPU_REG_PC      7   /* setjmp register #7 contains RIP */
+
+/* glibc keeps the registers in a struct, and mangles SP and PC with the
+ * pointer guard of the thread: xor, then rotate left by 17 bits */
+#define CMT_CPU_REG(state, reg)   ((state)[0].__jmpbuf[reg])
+#define CMT_CPU_VALUE(value)      cmt_ptr_mangle((long) (value))
+
+static inline long cmt_ptr_mangle(long value) {
+	long guard;
+	asm ("mov %%fs:0x30, %0" : "=r" (guard));
+	value ^= guard;
+	return (long) (((unsigned long) value << 17) | ((unsigned long) value >> 47));
+}
+
+/* the entry point starts as if called: the SysV ABI expects RSP+8 aligned */
+#define CMT_CPU_INITIAL_SP(top)   ((char *) (top) - 8)
+
 #else
 #error "Unsupported ARCH for Cooperative Scheduler"
 #endif
 
+#ifndef CMT_CPU_REG
+#define CMT_CPU_REG(state, reg)   ((state)[reg])
+#define CMT_CPU_VALUE(value)      ((int) (value))
+#define CMT_CPU_INITIAL_SP(top)   (top)
+#endif
+
 typedef struct {
 	jmp_buf cpu_state;
 	int status;
+	int priority;
+	void * stack_base;  /* lowest address of the task stack */
+	int stack_size;
 	void (*entry_point)();
+	mt_task_stats_t stats;
 } cmt_task_t;
 
 typedef struct {
 	cmt_task_t tasks[CMT_MAX_TASKS];
+	mt_ready_queue_t ready;
 	int current_task;
-	void * stack_adr;
-	int stack_size;
+	int stack_size;     /* default stack size */
 	int running;
 } cmt_data_t;
 
@@ -54,12 +95,17 @@ extern "C" void cmt_yeld();
 class CooperativeScheduler {
 private:
 	cmt_data_t data;
+	bool has_tasks();
 public:
 	CooperativeScheduler();
 	void begin();
 	void begin(int stack_size);
 	bool create_task(void (*entry)(void));
+	bool create_task(void (*entry)(void), int priority);
+	bool create_task(void (*entry)(void), int priority, int stack_size);
 	void run(void);
+	int getStackHighWater(int task);
+	void printStats(Print & out);
 };
 
 #endif /* COOPERATIVE_SCHEDULER_H_ */
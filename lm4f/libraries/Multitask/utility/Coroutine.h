@@ -0,0 +1,109 @@
+/*
+ * Coroutine.h
+ *
+ * Stackless coroutines, in the style of protothreads.
+ * A coroutine is an object whose run() function returns at each wait or
+ * yield point, and resumes after it on the next call. It needs no stack
+ * of its own, only its members: the state that must survive a wait has
+ * to be kept in members, not in local variables.
+ *
+ *	class Blink : public Coroutine {
+ *		char run() {
+ *			CO_BEGIN();
+ *			for (;;) {
+ *				digitalWrite(RED_LED, HIGH);
+ *				CO_DELAY(500);
+ *				digitalWrite(RED_LED, LOW);
+ *				CO_DELAY(500);
+ *			}
+ *			CO_END();
+ *		}
+ *	};
+ *
+ * The resume point is a case label of a switch statement: the CO_ macros
+ * can not be used inside a switch of the coroutine body.
+ *
+ * The same file is lm4f/libraries/Multitask/utility/Coroutine.h and
+ * msp430/libraries/Coroutine/Coroutine.h: keep the two copies identical.
+ */
+
+#ifndef COROUTINE_H_
+#define COROUTINE_H_
+
+#ifdef ENERGIA
+#include "Energia.h"
+#endif
+
+/* run() return values */
+#define CO_WAITING   0   /* blocked in CO_WAIT_UNTIL() or CO_DELAY() */
+#define CO_YIELDED   1   /* gave up the CPU with CO_YIELD() */
+#define CO_EXITED    2   /* terminated by CO_EXIT() */
+#define CO_ENDED     3   /* reached CO_END() */
+
+class Coroutine {
+public:
+	Coroutine() : co_line(0), co_next(0) {
+	}
+	virtual ~Coroutine() {
+	}
+
+	/*
+	 * Coroutine body, written between CO_BEGIN() and CO_END().
+	 * Returns CO_WAITING or CO_YIELDED until it terminates.
+	 */
+	virtual char run() = 0;
+
+	/*
+	 * Restarts the coroutine from CO_BEGIN().
+	 */
+	void reset() {
+		co_line = 0;
+	}
+
+	unsigned short co_line;     /* resume point: source line, 0 at start */
+	unsigned long co_wake;      /* millis() deadline of CO_DELAY() */
+	Coroutine * co_next;        /* CoroutineScheduler list */
+};
+
+#define CO_BEGIN()            switch (co_line) { case 0:
+
+#define CO_END()              } co_line = 0; return CO_ENDED
+
+/* Waits while 'cond' is false: run() returns until it becomes true. */
+#define CO_WAIT_UNTIL(cond)   do { co_line = __LINE__; case __LINE__: \
+                                   if (!(cond)) return CO_WAITING; } while (0)
+
+#define CO_WAIT_WHILE(cond)   CO_WAIT_UNTIL(!(cond))
+
+/* Lets the other coroutines run once. */
+#define CO_YIELD()            do { co_line = __LINE__; return CO_YIELDED; \
+                                   case __LINE__:; } while (0)
+
+/* Waits for 'ms' milliseconds. */
+#define CO_DELAY(ms)          do { co_wake = millis() + (ms); \
+                                   CO_WAIT_UNTIL((long) (millis() - co_wake) >= 0); } while (0)
+
+/* Runs the coroutine 'child' from its start until it terminates. */
+#define CO_SPAWN(child)       do { (child).reset(); \
+                                   CO_WAIT_UNTIL((child).run() >= CO_EXITED); } while (0)
+
+#define CO_EXIT()             do { co_line = 0; return CO_EXITED; } while (0)
+
+#define CO_RESTART()          do { co_line = 0; return CO_WAITING; } while (0)
+
+/*
+ * Runs a set of coroutines in round-robin, from loop() or with run().
+ */
+class CoroutineScheduler {
+private:
+	Coroutine * head;
+	Coroutine * tail;
+public:
+	CoroutineScheduler();
+	void add(Coroutine & co);
+	void remove(Coroutine & co);
+	int runOnce();
+	void run();
+};
+
+#endif /* COROUTINE_H_ */
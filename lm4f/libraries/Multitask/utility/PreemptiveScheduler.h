@@ -8,15 +8,20 @@
 #ifndef PREEMPTIVESCHEDULER_H_
 #define PREEMPTIVESCHEDULER_H_
 
-#include <setjmp.h>
+#ifdef __x86_64__
+#include <ucontext.h>
+#endif
+#include "ReadyQueue.h"
+#include "StackPool.h"
+#include "TaskStats.h"
 
 /* Constants - do not change */
 #define PMT_MAIN_TASK         0   /* MAIN task must be task 0 */
 #define PMT_STATUS_FREE       0
-#define PMT_STATUS_CREATED    1
-#define PMT_STATUS_PREPARING  2
-#define PMT_STATUS_READY_JMP  3
-#define PMT_STATUS_READY_INT  4
+#define PMT_STATUS_CREATED    1   /* MAIN task only: never picked from the ready queue */
+#define PMT_STATUS_READY      2   /* stack frame built, can be scheduled */
+#define PMT_STATUS_EXITED     3   /* terminated, slot released on next switch */
+#define PMT_STATUS_BLOCKED    4   /* waiting, out of the ready queue */
 
 
 
@@ -24,22 +29,41 @@
 
 #ifdef __ARM_ARCH_7EM__
 
-#define PMT_MAX_TASKS               8
+#define PMT_MAX_TASKS              32
 #define PMT_STACK_SIZE           2048
-#define PMT_PREALLOC_STACK          1
 #define PMT_SWITCH_FREQ    (F_CPU/100)
 
-#define PMT_CPU_REG_SP        8   /* setjmp register #8 contains the SP */
-#define PMT_CPU_REG_PC        9   /* setjmp register #9 contains the PC */
+/* Tasks that use the FPU need 136 more bytes of stack for the FP context:
+ * s0-s15 and FPSCR stacked by the hardware, s16-s31 by the PendSV handler */
+#define PMT_EXC_RETURN_PSP   0xFFFFFFFD   /* return to thread mode, PSP, no FP frame */
+#define PMT_INITIAL_XPSR     0x01000000   /* thumb bit set */
+
+/* One-shot timer releasing the periodic tasks, 32 bits counting F_CPU */
+#ifdef TARGET_IS_SNOWFLAKE_RA0
+#define PMT_RELEASE_TIMER       TIMER6_BASE
+#define PMT_RELEASE_PERIPH      SYSCTL_PERIPH_TIMER6
+#define PMT_RELEASE_CFG         TIMER_CFG_ONE_SHOT
+#define PMT_RELEASE_INT         INT_TIMER6A
+#define PMT_RELEASE_HANDLER     Timer6AIntHandler
+#else
+#define PMT_RELEASE_TIMER       WTIMER5_BASE
+#define PMT_RELEASE_PERIPH      SYSCTL_PERIPH_WTIMER5
+#define PMT_RELEASE_CFG         (TIMER_CFG_SPLIT_PAIR | TIMER_CFG_A_ONE_SHOT)
+#define PMT_RELEASE_INT         INT_WTIMER5A
+#define PMT_RELEASE_HANDLER     WideTimer5AIntHandler
+#endif
 
 #elif defined(__i386__)
 
 /* PreemptiveScheduler configuration */
 #define PMT_STACK_SIZE           4096
-#define PMT_PREALLOC_STACK          1
 
-#define PMT_CPU_REG_SP        7   /* setjmp register #7 contains the ESP */
-#define PMT_CPU_REG_PC        8   /* setjmp register #8 contains the EIP */
+#elif defined(__x86_64__)
+
+/* Linux host port: the signal frames of SIGALRM land on the task stacks */
+#define PMT_MAX_TASKS              32
+#define PMT_STACK_SIZE          16384
+#define PMT_SWITCH_PERIOD          10   /* switch tick, in milliseconds */
 
 #endif
 
@@ -49,39 +73,92 @@
 #define PMT_MAX_TASKS         8
 #endif
 
+#if PMT_MAX_TASKS > MT_QUEUE_SIZE
+#error "PMT_MAX_TASKS must not be greater than MT_QUEUE_SIZE"
+#endif
+
 #ifndef PMT_STACK_SIZE
 #define PMT_STACK_SIZE     1024
 #endif
 
+#ifndef PMT_MAX_PERIODIC
+#define PMT_MAX_PERIODIC      8
+#endif
+
+/*
+ * Task control block.
+ * The 'sp' and 'exc_return' fields must be the first ones:
+ * they are accessed by offset from the PendSV handler.
+ */
 typedef struct {
-	jmp_buf cpu_context;
-	int status;
+	void * sp;                 /* saved stack pointer (PSP, or MSP for the MAIN task) */
+	unsigned int exc_return;   /* EXC_RETURN value used to resume the task */
+	volatile int status;
+	int priority;
+	void * stack_base;         /* lowest address of the task stack */
+	int stack_size;
 	void (*entry_point)();
+	mt_task_stats_t stats;
+#ifdef __x86_64__
+	ucontext_t context;        /* saved context of the host port */
+#endif
 } pmt_task_t;
 
+/*
+ * Periodic task, released every 'period' cycles by the release timer.
+ */
+typedef struct {
+	int task;                  /* task id, or MT_NO_TASK for a free slot */
+	void (*job)();             /* called once per release */
+	unsigned long period_us;
+	unsigned int period;       /* in cycles */
+	unsigned long long release; /* cycle count of the next release */
+	volatile int waiting;      /* blocked until the release */
+	volatile int stopping;     /* stop_periodic() called */
+	mt_periodic_stats_t stats;
+} pmt_periodic_t;
+
 typedef struct {
-	int running;
+	volatile int running;
 	pmt_task_t tasks[PMT_MAX_TASKS];
 	volatile int current_task;
-	void * stack_adr;
-	int stack_size;
+	mt_ready_queue_t ready;
+	int stack_size;            /* default stack size */
+	int worker_task;           /* task running the deferred work, or MT_NO_TASK */
+	pmt_periodic_t periodic[PMT_MAX_PERIODIC];
+	bool release_timer;        /* release timer initialized */
 } pmt_data_t;
 
+extern "C" void pmt_yield();
+
 class PreemptiveScheduler
 {
 private:
 	pmt_data_t data;
-	void fork_task(int num_task);
-	void fork_all();
+	void init_task_stack(int num_task);
+	int add_task(void (*entry)(void), int priority, int stack_size);
 	bool has_tasks();
+	void idle();
+	void stop_worker();
 	void enable_timers();
 	void disable_timers();
+	void enable_release_timer();
 public:
 	PreemptiveScheduler();
 	void begin();
 	void begin(int stack_size);
 	bool create_task(void (*entry)(void));
+	bool create_task(void (*entry)(void), int priority);
+	bool create_task(void (*entry)(void), int priority, int stack_size);
+	bool create_worker();
+	bool create_worker(int priority);
+	int create_periodic(void (*entry)(void), unsigned long period_us, int priority);
+	void stop_periodic(int task);
+	bool getPeriodicStats(int task, mt_periodic_stats_t & stats);
+	void printPeriodicStats(Print & out);
 	void run(void);
+	int getStackHighWater(int task);
+	void printStats(Print & out);
 };
 
 #endif /* PREEMPTIVESCHEDULER_H_ */
@@ -0,0 +1,110 @@
+/*
+ * ReadyQueue.h
+ *
+ * Priority ready queue shared by the Multitask schedulers.
+ * Keeps one FIFO list of task ids per priority and a bitmap of the
+ * non-empty lists, so the highest priority ready task is found with a
+ * single CLZ instruction, regardless of the number of tasks.
+ */
+
+#ifndef READYQUEUE_H_
+#define READYQUEUE_H_
+
+#define MT_MAX_PRIORITIES     32   /* one bit of the ready bitmap per priority */
+#define MT_LOWEST_PRIORITY     0
+#define MT_HIGHEST_PRIORITY   (MT_MAX_PRIORITIES - 1)
+#define MT_DEFAULT_PRIORITY    8
+#define MT_QUEUE_SIZE         32   /* task ids must be lower than this */
+#define MT_NO_TASK           (-1)
+
+typedef struct {
+	unsigned int bitmap;                    /* bit n set: priority n has ready tasks */
+	signed char head[MT_MAX_PRIORITIES];
+	signed char tail[MT_MAX_PRIORITIES];
+	signed char next[MT_QUEUE_SIZE];
+	signed char prev[MT_QUEUE_SIZE];
+	unsigned char priority[MT_QUEUE_SIZE];
+} mt_ready_queue_t;
+
+/*
+ * Clamps a priority to the valid range.
+ */
+static inline int mt_rq_priority(int priority) {
+	if (priority < MT_LOWEST_PRIORITY)
+		return MT_LOWEST_PRIORITY;
+	if (priority > MT_HIGHEST_PRIORITY)
+		return MT_HIGHEST_PRIORITY;
+	return priority;
+}
+
+static inline void mt_rq_init(mt_ready_queue_t * q) {
+	q->bitmap = 0;
+	for (int i = 0; i < MT_MAX_PRIORITIES; i++)
+		q->head[i] = q->tail[i] = MT_NO_TASK;
+}
+
+/*
+ * Appends the task at the end of the list of its priority.
+ */
+static inline void mt_rq_insert(mt_ready_queue_t * q, int id, int priority) {
+	q->priority[id] = priority;
+	q->next[id] = MT_NO_TASK;
+	q->prev[id] = q->tail[priority];
+	if (q->tail[priority] == MT_NO_TASK)
+		q->head[priority] = id;
+	else
+		q->next[(int) q->tail[priority]] = id;
+	q->tail[priority] = id;
+	q->bitmap |= (1u << priority);
+}
+
+/*
+ * Removes a queued task.
+ */
+static inline void mt_rq_remove(mt_ready_queue_t * q, int id) {
+	int priority = q->priority[id];
+	int prev = q->prev[id];
+	int next = q->next[id];
+	if (prev == MT_NO_TASK)
+		q->head[priority] = next;
+	else
+		q->next[prev] = next;
+	if (next == MT_NO_TASK)
+		q->tail[priority] = prev;
+	else
+		q->prev[next] = prev;
+	if (q->head[priority] == MT_NO_TASK)
+		q->bitmap &= ~(1u << priority);
+}
+
+/*
+ * Moves the first task of the list to its end (round-robin).
+ */
+static inline void mt_rq_rotate(mt_ready_queue_t * q, int priority) {
+	int id = q->head[priority];
+	if (id == MT_NO_TASK || q->next[id] == MT_NO_TASK)
+		return;
+	mt_rq_remove(q, id);
+	mt_rq_insert(q, id, priority);
+}
+
+/*
+ * Returns the highest priority with ready tasks, or -1 if the queue is empty.
+ */
+static inline int mt_rq_top_priority(const mt_ready_queue_t * q) {
+	if (!q->bitmap)
+		return -1;
+	return 31 - __builtin_clz(q->bitmap);
+}
+
+/*
+ * Returns the next task to run, or MT_NO_TASK if the queue is empty.
+ */
+static inline int mt_rq_top(const mt_ready_queue_t * q) {
+	int priority = mt_rq_top_priority(q);
+	if (priority < 0)
+		return MT_NO_TASK;
+	return q->head[priority];
+}
+
+#endif /* READYQUEUE_H_ */
@@ -0,0 +1,137 @@
+/*
+ * SchedulerOps.h
+ *
+ * Interface between the Multitask blocking primitives and the scheduler
+ * that is running. The scheduler installs its operations in run() and
+ * removes them when run() returns.
+ */
+
+#ifndef SCHEDULEROPS_H_
+#define SCHEDULEROPS_H_
+
+#include <stdint.h>
+#ifdef ENERGIA
+#include <Energia.h>
+#endif
+
+#define MT_MAIN_TASK    0   /* the MAIN task is task 0 in both schedulers */
+#define MT_FOREVER      0xFFFFFFFFUL   /* timeout: wait with no time limit */
+
+/*
+ * Interrupt priority of the scheduler lock (CriticalSection.h).
+ * With 0, mt_lock() masks all the interrupts. Otherwise it only masks the
+ * interrupts of priority MT_KERNEL_PRIORITY and lower: the more urgent
+ * interrupts are never delayed by the scheduler, but must not call any
+ * Multitask function. The schedulers set the priority of their own timer
+ * interrupts to MT_KERNEL_PRIORITY.
+ */
+#ifndef MT_KERNEL_PRIORITY
+#define MT_KERNEL_PRIORITY      0
+#endif
+
+/* the UART interrupt wakes the tasks reading Serial (notifyReaders()) */
+#if MT_KERNEL_PRIORITY && defined(SERIAL_INT_PRIORITY) && MT_KERNEL_PRIORITY > SERIAL_INT_PRIORITY
+#error "MT_KERNEL_PRIORITY must not be lower than SERIAL_INT_PRIORITY (a higher value)"
+#endif
+
+/*
+ * Scheduler operations.
+ * All of them, except wait(), are called with interrupts disabled.
+ */
+typedef struct {
+	int (*current_task)();          /* id of the running task */
+	int (*task_priority)(int id);
+	void (*block)(int id);          /* takes the task out of the ready queue */
+	void (*wake)(int id);           /* puts a blocked task back in the ready queue */
+	void (*wait)();                 /* switches away from a blocked task */
+} mt_scheduler_t;
+
+extern const mt_scheduler_t * volatile mt_scheduler;
+
+/*
+ * Wait list: bit n is set while task n waits on the list.
+ */
+typedef volatile unsigned int mt_wait_list_t;
+
+/*
+ * Disables the interrupts that can use the scheduler (MT_KERNEL_PRIORITY).
+ * Returns the previous state: non-zero if they were already disabled.
+ */
+int mt_lock();
+
+/*
+ * Restores the interrupt state returned by mt_lock().
+ */
+void mt_unlock(int oldLevel);
+
+/*
+ * Returns true if called from an interrupt handler.
+ */
+bool mt_in_isr();
+
+/*
+ * Waits for a wake up on 'list'. Must be called with the lock taken by
+ * mt_lock(), and always releases it.
+ * Tasks are blocked until mt_wake_one()/mt_wake_all() is called on the list.
+ * The MAIN task, or any code when no scheduler runs, only yelds once,
+ * so the caller must check its condition again.
+ * Returns false if the caller can not wait (interrupt handler).
+ */
+bool mt_wait(mt_wait_list_t * list, int oldLevel);
+
+/*
+ * Same as mt_wait(), but the task is also woken when millis() reaches
+ * 'deadline'. 'list' can be NULL to just sleep until the deadline.
+ */
+bool mt_wait_until(mt_wait_list_t * list, int oldLevel, unsigned long deadline);
+
+/*
+ * Wakes the highest priority task waiting on 'list'.
+ * Must be called with interrupts disabled.
+ * Returns the id of the task woken, or -1 if the list was empty.
+ */
+int mt_wake_one(mt_wait_list_t * list);
+
+/*
+ * Wakes all the tasks waiting on 'list'.
+ * Must be called with interrupts disabled.
+ */
+void mt_wake_all(mt_wait_list_t * list);
+
+/*
+ * Returns the deadline for a timeout in milliseconds from now.
+ */
+unsigned long mt_deadline(unsigned long timeout);
+
+/*
+ * Returns true if millis() has reached 'deadline'.
+ */
+bool mt_expired(unsigned long deadline);
+
+/*
+ * Sleeps the current task until millis() reaches 'tick'.
+ * The task leaves the ready queue until then.
+ */
+void task_sleep_until(unsigned long tick);
+
+/*
+ * Sleeps the current task for 'ms' milliseconds.
+ */
+void task_sleep(unsigned long ms);
+
+/*
+ * Idle hook, called by the MAIN task of the schedulers with interrupts
+ * disabled when no task is ready. Sleeps with the millisecond tick
+ * suppressed until the next deadline of the sleep list or any interrupt.
+ */
+void mt_idle();
+
+/*
+ * Hooks called by the core (wiring.c, Stream.cpp).
+ */
+extern "C" void mt_tick(unsigned long now);
+extern "C" int mt_delay(uint32_t ms);
+extern "C" void mt_notify(mt_wait_list_t * list);
+extern "C" unsigned long mt_next_tick(unsigned long now);
+
+#endif /* SCHEDULEROPS_H_ */
@@ -0,0 +1,58 @@
+/*
+ * StackPool.h
+ *
+ * Task stack allocator shared by the Multitask schedulers.
+ * Stacks are carved from a static pool placed by the linker in the
+ * .mtstack section, and returned to it when the task exits.
+ */
+
+#ifndef STACKPOOL_H_
+#define STACKPOOL_H_
+
+/* Stack pool configuration */
+#if defined(TARGET_IS_SNOWFLAKE_RA0)
+#define MT_STACK_POOL_SIZE   65536
+#elif defined(__ARM_ARCH_7EM__)
+#define MT_STACK_POOL_SIZE   12288
+#else
+#define MT_STACK_POOL_SIZE  262144
+#endif
+
+#ifdef __x86_64__
+#define MT_STACK_ALIGN          16   /* SysV ABI stack alignment */
+#else
+#define MT_STACK_ALIGN           8   /* AAPCS stack alignment */
+#endif
+#define MT_MIN_STACK_SIZE      256
+#define MT_STACK_CANARY  0xA5A5A5A5   /* fill pattern of unused stack */
+
+/*
+ * Allocates a stack of 'size' bytes, rounded up to MT_STACK_ALIGN.
+ * Returns the lowest address of the stack (8-byte aligned),
+ * or NULL if there is no room left in the pool.
+ * Not reentrant: callers must serialize access to the pool.
+ */
+void * mt_stack_alloc(int size);
+
+/*
+ * Returns a stack allocated by mt_stack_alloc() to the pool.
+ */
+void mt_stack_free(void * stack);
+
+/*
+ * Returns the number of free bytes of the pool.
+ */
+int mt_stack_available();
+
+/*
+ * Fills a stack with MT_STACK_CANARY, before the task starts.
+ */
+void mt_stack_paint(void * stack, int size);
+
+/*
+ * Returns the number of bytes of a painted stack that were never used.
+ * Stacks grow down, so the canary is checked from the lowest address up.
+ */
+int mt_stack_unused(const void * stack, int size);
+
+#endif /* STACKPOOL_H_ */
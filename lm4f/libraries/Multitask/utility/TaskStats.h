@@ -0,0 +1,103 @@
+/*
+ * TaskStats.h
+ *
+ * Run time accounting for the tasks of the Multitask schedulers.
+ * Times are measured in CPU cycles with cycles64(), which also counts
+ * the cycles slept in the tickless idle and does not wrap.
+ */
+
+#ifndef TASKSTATS_H_
+#define TASKSTATS_H_
+
+class Print;
+
+/*
+ * Statistics of one task.
+ */
+typedef struct {
+	unsigned long long cycles;  /* time the task has run */
+	unsigned int switches;      /* times the task was switched in */
+	unsigned int max_latency;   /* longest time from wake up to run, in cycles */
+	unsigned long long ready_at; /* cycle count of the last wake up */
+	int waking;                 /* woken, not run yet */
+} mt_task_stats_t;
+
+#define MT_HIST_BUCKETS     16
+
+/*
+ * Timing of the jobs of a periodic task. Times are in microseconds.
+ * Bucket 0 of the histograms counts the times under 1us, bucket n the
+ * times from 2^(n-1) to 2^n - 1 us, and the last one all the longer times.
+ */
+typedef struct {
+	unsigned int releases;                  /* jobs run */
+	unsigned int misses;                    /* jobs that ended after the next release */
+	unsigned int max_jitter;
+	unsigned int max_exec;
+	unsigned int jitter[MT_HIST_BUCKETS];   /* start delay from the release */
+	unsigned int exec[MT_HIST_BUCKETS];     /* CPU time used by the job */
+} mt_periodic_stats_t;
+
+/*
+ * Returns the 64-bit cycle counter.
+ */
+unsigned long long mt_cycles();
+
+/*
+ * Clears the statistics of a task.
+ */
+void mt_stats_init(mt_task_stats_t * stats);
+
+/*
+ * Starts the accounting. Called by the schedulers in run().
+ */
+void mt_stats_start();
+
+/*
+ * Accounts the time run by 'prev' since the last switch, and the switch
+ * to 'next'. Called with interrupts disabled.
+ */
+void mt_stats_switch(mt_task_stats_t * prev, mt_task_stats_t * next);
+
+/*
+ * Records the wake up of a task, to measure its latency.
+ * Called with interrupts disabled.
+ */
+void mt_stats_ready(mt_task_stats_t * stats);
+
+/*
+ * Returns the cycles run by the current task, including the time since it
+ * was switched in. Called with interrupts disabled.
+ */
+unsigned long long mt_stats_runtime(const mt_task_stats_t * stats);
+
+/*
+ * Clears the statistics of a periodic task.
+ */
+void mt_periodic_init(mt_periodic_stats_t * stats);
+
+/*
+ * Records one job of a periodic task: its start jitter and execution time
+ * in cycles, and whether it missed its deadline.
+ */
+void mt_periodic_record(mt_periodic_stats_t * stats, unsigned int jitter, unsigned int exec, bool missed);
+
+/*
+ * Prints the timing of a periodic task and its histograms.
+ */
+void mt_periodic_print(Print & out, int id, unsigned long period_us, const mt_periodic_stats_t * stats);
+
+/*
+ * Prints the header of the statistics table.
+ */
+void mt_stats_print_header(Print & out);
+
+/*
+ * Prints one line of the statistics table.
+ * 'total' is the sum of the cycles of all the tasks, 'unused' the
+ * unused stack bytes or -1 if unknown.
+ */
+void mt_stats_print(Print & out, int id, int priority, const mt_task_stats_t * stats,
+		unsigned long long total, int stack_size, int unused);
+
+#endif /* TASKSTATS_H_ */
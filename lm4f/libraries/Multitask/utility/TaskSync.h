@@ -0,0 +1,178 @@
+/*
+ * TaskSync.h
+ *
+ * Blocking synchronization primitives for the Multitask schedulers.
+ * A task that has to wait is taken out of the ready queue until the
+ * resource is released, instead of spinning.
+ */
+
+#ifndef TASKSYNC_H_
+#define TASKSYNC_H_
+
+#include "SchedulerOps.h"
+
+class Stream;
+
+/*
+ * Counting semaphore.
+ */
+class Semaphore {
+private:
+	volatile int count;
+	int max_count;
+	mt_wait_list_t waiters;
+public:
+	Semaphore(int initial = 0, int max = 0x7FFFFFFF);
+	bool take(unsigned long timeout = MT_FOREVER);
+	bool tryTake();
+	void give();
+	void giveFromISR();
+	int available();
+};
+
+/*
+ * Mutual exclusion lock, owned by the task that locked it.
+ * Must not be used from interrupt handlers.
+ */
+class Mutex {
+private:
+	volatile int owner;
+	mt_wait_list_t waiters;
+public:
+	Mutex();
+	bool lock(unsigned long timeout = MT_FOREVER);
+	bool tryLock();
+	bool unlock();
+};
+
+/*
+ * Waits up to 'timeout' milliseconds until 'stream' has data to read.
+ * The task is blocked until the driver signals new data, or the end of the
+ * connection, from its interrupt handler (Stream::notifyReaders()).
+ * The MAIN task, or any code when no scheduler runs, polls available().
+ * Returns true if data is available.
+ */
+bool waitReadable(Stream & stream, unsigned long timeout = MT_FOREVER);
+
+/*
+ * Fixed size message queue of N items of type T.
+ * Items are copied in and out of the queue.
+ */
+template<typename T, int N>
+class Queue {
+private:
+	T items[N];
+	volatile int head;
+	volatile int count;
+	mt_wait_list_t receivers;
+	mt_wait_list_t senders;
+
+	/* called with interrupts disabled */
+	bool put(const T & item) {
+		if (count >= N)
+			return false;
+		int tail = head + count;
+		if (tail >= N)
+			tail -= N;
+		items[tail] = item;
+		count++;
+		mt_wake_one(&receivers);
+		return true;
+	}
+
+	/* called with interrupts disabled */
+	bool get(T & item) {
+		if (count <= 0)
+			return false;
+		item = items[head];
+		if (++head >= N)
+			head = 0;
+		count--;
+		mt_wake_one(&senders);
+		return true;
+	}
+
+public:
+	Queue() : head(0), count(0), receivers(0), senders(0) {
+	}
+
+	/*
+	 * Sends an item, waiting up to 'timeout' milliseconds while the queue
+	 * is full.
+	 * Returns false if the queue is still full after the timeout, or if
+	 * the caller can not wait.
+	 */
+	bool send(const T & item, unsigned long timeout = MT_FOREVER) {
+		unsigned long deadline = mt_deadline(timeout);
+		int oldLevel = mt_lock();
+		while (!put(item)) {
+			if (timeout != MT_FOREVER && mt_expired(deadline)) {
+				mt_unlock(oldLevel);
+				return false;
+			}
+			if (timeout == MT_FOREVER ? !mt_wait(&senders, oldLevel) : !mt_wait_until(&senders, oldLevel, deadline))
+				return false;
+			oldLevel = mt_lock();
+		}
+		mt_unlock(oldLevel);
+		return true;
+	}
+
+	/*
+	 * Sends an item if there is room in the queue.
+	 */
+	bool trySend(const T & item) {
+		int oldLevel = mt_lock();
+		bool ret = put(item);
+		mt_unlock(oldLevel);
+		return ret;
+	}
+
+	/*
+	 * Sends an item from an interrupt handler, never waits.
+	 */
+	bool sendFromISR(const T & item) {
+		return trySend(item);
+	}
+
+	/*
+	 * Receives an item, waiting up to 'timeout' milliseconds while the
+	 * queue is empty.
+	 * Returns false if the queue is still empty after the timeout, or if
+	 * the caller can not wait.
+	 */
+	bool receive(T & item, unsigned long timeout = MT_FOREVER) {
+		unsigned long deadline = mt_deadline(timeout);
+		int oldLevel = mt_lock();
+		while (!get(item)) {
+			if (timeout != MT_FOREVER && mt_expired(deadline)) {
+				mt_unlock(oldLevel);
+				return false;
+			}
+			if (timeout == MT_FOREVER ? !mt_wait(&receivers, oldLevel) : !mt_wait_until(&receivers, oldLevel, deadline))
+				return false;
+			oldLevel = mt_lock();
+		}
+		mt_unlock(oldLevel);
+		return true;
+	}
+
+	/*
+	 * Receives an item if the queue is not empty.
+	 */
+	bool tryReceive(T & item) {
+		int oldLevel = mt_lock();
+		bool ret = get(item);
+		mt_unlock(oldLevel);
+		return ret;
+	}
+
+	/*
+	 * Returns the number of items in the queue.
+	 */
+	int available() {
+		return count;
+	}
+};
+
+#endif /* TASKSYNC_H_ */
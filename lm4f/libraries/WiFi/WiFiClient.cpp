@@ -322,6 +322,29 @@ int WiFiClient::peek()
     }
 }
 
+//
+//points ptr at the rest of the receive buffer, receiving more data first
+//if it has all been read
+//
+size_t WiFiClient::peekSpan(const uint8_t *&ptr)
+{
+    int len = available();
+    ptr = &rx_buffer[rx_currentIndex];
+    return len;
+}
+
+void WiFiClient::consume(size_t n)
+{
+    int len = rx_fillLevel - rx_currentIndex;
+    if (len <= 0) {
+        return;
+    }
+    if (n > (size_t)len) {
+        n = len;
+    }
+    rx_currentIndex += n;
+}
+
 //--tested, working--//
 void WiFiClient::flush()
 {
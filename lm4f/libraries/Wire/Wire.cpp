@@ -231,6 +231,7 @@ uint8_t TwoWire::txWriteIndex = 0;
 
 uint8_t TwoWire::transmitting = 0;
 uint8_t TwoWire::currentState = IDLE;
+volatile uint8_t TwoWire::receivePending = 0;
 
 void (*TwoWire::user_onRequest)(void);
 void (*TwoWire::user_onReceive)(int);
@@ -628,6 +629,12 @@ void TwoWire::I2CIntHandler(void) {
 	switch(I2CSlaveStatus(SLAVE_BASE) & (I2C_SCSR_TREQ | I2C_SCSR_RREQ)) {
 
 		case(I2C_SLAVE_ACT_RREQ)://data received
+			if(receivePending) {
+				// onReceive of the last write has not run yet: the byte
+				// stays in the slave, stretching the clock, until it has
+				I2CSlaveIntDisableEx(SLAVE_BASE, I2C_SLAVE_INT_DATA);
+				break;
+			}
 			if(I2CSlaveStatus(SLAVE_BASE) & I2C_SCSR_FBR)
 				currentState = SLAVE_RX;
 			if(!RX_BUFFER_FULL) {
@@ -670,12 +677,28 @@ void TwoWire::I2CIntHandler(void) {
 
 	if(stopDetected && currentState == SLAVE_RX) {
 		int avail = available();
-		user_onReceive(avail);
 		currentState = IDLE;
+		// with a worker task, the callback runs at thread level and
+		// the next write is held until it has run
+		receivePending = hasDeferredWorker();
+		if(!receivePending || !deferWork(deferredReceive, avail)) {
+			receivePending = 0;
+			user_onReceive(avail);
+		}
 	}
 
 }
 
+// onReceive callback run by the worker task, with the bytes of the write
+void TwoWire::deferredReceive(uint32_t avail) {
+	user_onReceive((int)avail);
+	receivePending = 0;
+	// resume a write held by the interrupt handler
+	I2CSlaveIntEnableEx(SLAVE_BASE, I2C_SLAVE_INT_DATA);
+	if(I2CSlaveStatus(SLAVE_BASE) & I2C_SCSR_RREQ)
+		ROM_IntPendSet(g_uli2cInt[i2cModule]);
+}
+
 void
 I2CIntHandler(void)
 {
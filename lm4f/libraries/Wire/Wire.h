@@ -32,10 +32,12 @@ class TwoWire : public Stream
 
 		static uint8_t transmitting;
 		static uint8_t currentState;
+		static volatile uint8_t receivePending;
 		static void (*user_onRequest)(void);
 		static void (*user_onReceive)(int);
 		static void onRequestService(void);
 		static void onReceiveService(uint8_t*, int);
+		static void deferredReceive(uint32_t);
 		
 		uint8_t getRxData(unsigned long cmd);
 		uint8_t sendTxData(unsigned long cmd, uint8_t data);
@@ -0,0 +1,240 @@
+/******************************************
+ * PrintBenchmark.cpp
+ * Number formatting benchmark of Print, for the host.
+ * Compares the cycles per number of the formatting of wiring_format.c
+ * with the former Print::printNumber() and Print::printFloat(), and
+ * checks that both give the same text.
+ *
+ * Usage: print_benchmark [numbers per test]
+ ******************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <x86intrin.h>
+#include "wiring_format.h"
+
+#define BENCH_VALUES    4096
+
+static unsigned long bench_ints[BENCH_VALUES];
+static double bench_floats[BENCH_VALUES];
+static volatile unsigned long bench_sink;
+
+/*
+ * Sink of the formatted text, as Print::write(buffer, size).
+ */
+static void __attribute__((noinline)) bench_write(const char *str, size_t size) {
+	bench_sink += size + (unsigned char) str[0];
+}
+
+/* former Print::printNumber() */
+static size_t __attribute__((noinline)) old_number(char *out, unsigned long n, unsigned char base) {
+	char buf[8 * sizeof(long) + 1];
+	char *str = &buf[sizeof(buf) - 1];
+
+	*str = '\0';
+	if (base < 2)
+		base = 10;
+	do {
+		unsigned long m = n;
+		n /= base;
+		char c = m - base * n;
+		*--str = c < 10 ? c + '0' : c + 'A' - 10;
+	} while (n);
+
+	size_t len = strlen(str);
+	if (out)
+		memcpy(out, str, len + 1);
+	bench_write(str, len);
+	return len;
+}
+
+static size_t __attribute__((noinline)) new_number(char *out, unsigned long n, unsigned char base) {
+	char buf[FORMAT_ULONG_SIZE];
+	char *end = &buf[sizeof(buf)];
+	char *str = format_ulong(end, n, base);
+
+	if (out) {
+		memcpy(out, str, end - str);
+		out[end - str] = '\0';
+	}
+	bench_write(str, end - str);
+	return end - str;
+}
+
+/* former Print::printFloat(), one write per part as print() did */
+static size_t __attribute__((noinline)) old_float(char *out, double number, unsigned char digits) {
+	char part[16];
+	size_t n = 0;
+
+	if (out)
+		out[0] = '\0';
+	if (number < 0.0) {
+		bench_write("-", 1);
+		if (out)
+			strcat(out, "-");
+		n++;
+		number = -number;
+	}
+	double rounding = 0.5;
+	for (unsigned char i = 0; i < digits; ++i)
+		rounding /= 10.0;
+	number += rounding;
+
+	unsigned long int_part = (unsigned long) number;
+	double remainder = number - (double) int_part;
+	n += old_number(part, int_part, 10);
+	if (out)
+		strcat(out, part);
+	if (digits > 0) {
+		bench_write(".", 1);
+		if (out)
+			strcat(out, ".");
+		n++;
+	}
+	while (digits-- > 0) {
+		remainder *= 10.0;
+		int toPrint = int(remainder);
+		n += old_number(part, toPrint, 10);
+		if (out)
+			strcat(out, part);
+		remainder -= toPrint;
+	}
+	return n;
+}
+
+static size_t __attribute__((noinline)) new_float(char *out, double number, unsigned char digits) {
+	char buf[FORMAT_FLOAT_SIZE];
+	int len = format_double(buf, number, digits);
+
+	if (out) {
+		memcpy(out, buf, len);
+		out[len] = '\0';
+	}
+	bench_write(buf, len);
+	return len;
+}
+
+typedef size_t (*number_fn)(char *out, unsigned long n, unsigned char base);
+typedef size_t (*float_fn)(char *out, double number, unsigned char digits);
+
+static double bench_ints_cycles(number_fn fn, unsigned char base, long count) {
+	unsigned long long start = __rdtsc();
+	for (long i = 0; i < count; i++)
+		fn(NULL, bench_ints[i & (BENCH_VALUES - 1)], base);
+	return (double) (__rdtsc() - start) / count;
+}
+
+static double bench_floats_cycles(float_fn fn, unsigned char digits, long count) {
+	unsigned long long start = __rdtsc();
+	for (long i = 0; i < count; i++)
+		fn(NULL, bench_floats[i & (BENCH_VALUES - 1)], digits);
+	return (double) (__rdtsc() - start) / count;
+}
+
+/*
+ * Returns the number of values whose text differs. The float text may
+ * differ in the last decimal, where the former code accumulated the
+ * error of one multiplication per decimal.
+ */
+static long check_ints(unsigned char base) {
+	char a[80], b[80];
+	long diffs = 0;
+	for (int i = 0; i < BENCH_VALUES; i++) {
+		old_number(a, bench_ints[i], base);
+		new_number(b, bench_ints[i], base);
+		if (strcmp(a, b)) {
+			if (!diffs)
+				printf("  %lu base %d: old %s, new %s\n", bench_ints[i], base, a, b);
+			diffs++;
+		}
+	}
+	return diffs;
+}
+
+static long check_floats(unsigned char digits) {
+	char a[80], b[80];
+	long diffs = 0;
+	for (int i = 0; i < BENCH_VALUES; i++) {
+		old_float(a, bench_floats[i], digits);
+		new_float(b, bench_floats[i], digits);
+		if (strcmp(a, b))
+			diffs++;
+	}
+	return diffs;
+}
+
+/*
+ * Returns the number of the limit values whose text is not the expected
+ * one. The numbers beyond the 32 bit integer part print as "ovf" whatever
+ * the width of a long.
+ */
+static long check_limits() {
+	static const struct {
+		double number;
+		unsigned char digits;
+		const char *text;
+	} limits[] = {
+		{ FORMAT_DOUBLE_MAX, 2, "4294967040.00" },
+		{ -FORMAT_DOUBLE_MAX, 0, "-4294967040" },
+		{ 4294967295.0, 2, "ovf" },
+		{ 4294967296.0, 0, "ovf" },
+		{ -5e9, 2, "ovf" },
+		{ 1e300, 9, "ovf" },
+		{ 0.9999999999, 9, "1.000000000" },
+		{ 1.0 / 0.0, 2, "inf" },
+		{ -1.0 / 0.0, 2, "inf" },
+		{ 0.0 / 0.0, 2, "nan" },
+	};
+	char b[80];
+	long diffs = 0;
+	for (unsigned i = 0; i < sizeof(limits) / sizeof(limits[0]); i++) {
+		new_float(b, limits[i].number, limits[i].digits);
+		if (strcmp(b, limits[i].text)) {
+			printf("  %g with %d decimals: %s, expected %s\n", limits[i].number,
+					limits[i].digits, b, limits[i].text);
+			diffs++;
+		}
+	}
+	return diffs;
+}
+
+int main(int argc, char **argv) {
+	long count = argc > 1 ? atol(argv[1]) : 2000000;
+	static const unsigned char bases[] = { 10, 16, 2, 8, 36 };
+	static const unsigned char digits[] = { 2, 6 };
+
+	srand(1);
+	for (int i = 0; i < BENCH_VALUES; i++) {
+		/* every magnitude from 1 to 10 digits */
+		unsigned long v = ((unsigned long) rand() << 16) ^ rand();
+		bench_ints[i] = (v & 0xFFFFFFFFUL) >> (rand() % 32);
+		bench_floats[i] = ((double) rand() / RAND_MAX - 0.5) * (i & 1 ? 2000.0 : 2e7);
+	}
+
+	printf("cycles per number          former   wiring_format   diffs\n");
+	for (unsigned i = 0; i < sizeof(bases); i++) {
+		double o = bench_ints_cycles(old_number, bases[i], count);
+		double n = bench_ints_cycles(new_number, bases[i], count);
+		printf("  unsigned long, base %2d %8.1f   %13.1f   %5ld\n", bases[i], o, n, check_ints(bases[i]));
+	}
+	for (unsigned i = 0; i < sizeof(digits); i++) {
+		double o = bench_floats_cycles(old_float, digits[i], count);
+		double n = bench_floats_cycles(new_float, digits[i], count);
+		printf("  double, %d decimals     %8.1f   %13.1f   %5ld\n", digits[i], o, n, check_floats(digits[i]));
+	}
+	long diffs = check_limits();
+	printf("limit values: %ld diffs\n", diffs);
+	return diffs != 0;
+}
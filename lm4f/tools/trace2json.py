@@ -0,0 +1,138 @@
+#!/usr/bin/env python
+import json
+import sys
+
+'''
+This script converts the output of traceDump() (wiring_trace.cpp), captured
+from the serial port, to the Chrome trace event format. Open the result in
+chrome://tracing or https://ui.perfetto.dev
+
+    python trace2json.py capture.txt > trace.json
+
+The capture may contain other lines: only the ones between "TRACE" and
+"END" are read. The timeline shows the running task, the interrupt
+handlers (nested as they preempt each other) and the scheduler events.
+'''
+
+TRACE_EVENT_SWITCH = 1
+TRACE_EVENT_READY = 2
+TRACE_EVENT_BLOCK = 3
+TRACE_EVENT_ISR_ENTER = 4
+TRACE_EVENT_ISR_EXIT = 5
+TRACE_EVENT_RELEASE = 6
+TRACE_EVENT_USER = 256
+
+EXCEPTIONS = {11: "SVCall", 14: "PendSV", 15: "SysTick"}
+
+PID = 1
+TID_TASKS = 1
+TID_ISR = 2
+TID_EVENTS = 3
+
+
+def read_trace(lines):
+    hz = None
+    events = []
+    for line in lines:
+        fields = line.split()
+        if hz is None:
+            if len(fields) == 3 and fields[0] == "TRACE":
+                hz = float(fields[1])
+            continue
+        if fields == ["END"]:
+            break
+        if len(fields) != 3:
+            continue
+        events.append([int(f, 16) for f in fields])
+    if hz is None:
+        raise SystemExit("no TRACE header found")
+    return hz, events
+
+
+def unwrap(events):
+    # the 32 bit cycle counter wraps, and the events of an interrupt can be
+    # stored before the ones it preempted: times are made absolute from the
+    # shortest signed distance to the previous event, then sorted
+    absolute = 0
+    prev = None
+    for e in events:
+        if prev is not None:
+            delta = (e[0] - prev) & 0xFFFFFFFF
+            if delta >= 0x80000000:
+                delta -= 0x100000000
+            absolute += delta
+        prev = e[0]
+        e[0] = absolute
+    events.sort(key=lambda e: e[0])
+    return events
+
+
+def isr_name(number):
+    if number in EXCEPTIONS:
+        return EXCEPTIONS[number]
+    return "IRQ %d" % (number - 16)
+
+
+def convert(hz, events):
+    out = [
+        {"name": "process_name", "ph": "M", "pid": PID, "args": {"name": "lm4f"}},
+        {"name": "thread_name", "ph": "M", "pid": PID, "tid": TID_TASKS, "args": {"name": "tasks"}},
+        {"name": "thread_name", "ph": "M", "pid": PID, "tid": TID_ISR, "args": {"name": "interrupts"}},
+        {"name": "thread_name", "ph": "M", "pid": PID, "tid": TID_EVENTS, "args": {"name": "events"}},
+    ]
+    if not events:
+        return out
+    start = events[0][0]
+    task = None
+    task_start = 0
+    depth = 0
+
+    for time, event, arg in events:
+        ts = (time - start) * 1e6 / hz
+        if event == TRACE_EVENT_SWITCH:
+            if task is not None:
+                out.append({"name": "task %d" % task, "ph": "X", "pid": PID, "tid": TID_TASKS,
+                            "ts": task_start, "dur": ts - task_start})
+            task = arg
+            task_start = ts
+        elif event == TRACE_EVENT_ISR_ENTER:
+            depth += 1
+            out.append({"name": isr_name(arg), "ph": "B", "pid": PID, "tid": TID_ISR, "ts": ts})
+        elif event == TRACE_EVENT_ISR_EXIT:
+            # the exits of the handlers entered before the trace started
+            if depth > 0:
+                depth -= 1
+                out.append({"name": isr_name(arg), "ph": "E", "pid": PID, "tid": TID_ISR, "ts": ts})
+        else:
+            if event == TRACE_EVENT_READY:
+                name = "ready %d" % arg
+            elif event == TRACE_EVENT_BLOCK:
+                name = "block %d" % arg
+            elif event == TRACE_EVENT_RELEASE:
+                name = "release %d" % arg
+            elif event >= TRACE_EVENT_USER:
+                name = "user %d" % (event - TRACE_EVENT_USER)
+            else:
+                name = "event %d" % event
+            out.append({"name": name, "ph": "i", "s": "t", "pid": PID, "tid": TID_EVENTS,
+                        "ts": ts, "args": {"arg": arg}})
+
+    end = (events[-1][0] - start) * 1e6 / hz
+    if task is not None:
+        out.append({"name": "task %d" % task, "ph": "X", "pid": PID, "tid": TID_TASKS,
+                    "ts": task_start, "dur": end - task_start})
+    for n in range(depth):
+        out.append({"ph": "E", "pid": PID, "tid": TID_ISR, "ts": end})
+    return out
+
+
+def main():
+    lines = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    hz, events = read_trace(lines)
+    trace = {"traceEvents": convert(hz, unwrap(events)), "displayTimeUnit": "ns"}
+    json.dump(trace, sys.stdout, indent=1)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,233 @@
+/*
+ ************************************************************************
+ *	wiring_format.c
+ *
+ *	Energia core files
+ *
+ *
+ ***********************************************************************
+  Number formatting used by Print, shared by the cores.
+
+  MSP430 and C2000 have no divider, so a division per digit is a library
+  call. Base 10 divides by 100 with a reciprocal multiplication and
+  writes two digits at a time from a table; on MSP430, where the 32 bit
+  multiplication is a library call too, it divides by 10 with shifts and
+  adds. Bases 2, 4, 8, 16 and 32 use shifts and masks. The decimals of a
+  float are scaled to an integer by a single multiplication.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include <math.h>
+#include "wiring_format.h"
+
+#if !defined(__MSP430__)
+static const char format_digits2[200] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+#endif
+
+static const unsigned long format_pow10[FORMAT_MAX_DECIMALS + 1] = {
+    1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL,
+    100000000UL, 1000000000UL
+};
+
+static char *format_decimal(char *end, unsigned long n)
+{
+#if defined(__MSP430__)
+    unsigned long q, r;
+
+    /* n / 10 with shifts and adds (Hacker's Delight, divu10) */
+    while (n >= 10) {
+        q = (n >> 1) + (n >> 2);
+        q += q >> 4;
+        q += q >> 8;
+        q += q >> 16;
+        q >>= 3;
+        r = n - ((q << 3) + (q << 1));
+        if (r > 9) {
+            q++;
+            r -= 10;
+        }
+        *--end = '0' + r;
+        n = q;
+    }
+    *--end = '0' + n;
+#else
+    unsigned long q, r;
+
+    while (n >= 100) {
+#if ULONG_MAX == 0xFFFFFFFFUL
+        /* exact for any 32 bit n */
+        q = (unsigned long)(((unsigned long long)n * 0x51EB851FULL) >> 37);
+#else
+        q = n / 100;
+#endif
+        r = (n - q * 100) * 2;
+        end -= 2;
+        end[0] = format_digits2[r];
+        end[1] = format_digits2[r + 1];
+        n = q;
+    }
+    if (n >= 10) {
+        end -= 2;
+        end[0] = format_digits2[n * 2];
+        end[1] = format_digits2[n * 2 + 1];
+    } else {
+        *--end = '0' + n;
+    }
+#endif
+    return end;
+}
+
+char *format_ulong(char *end, unsigned long n, unsigned char base)
+{
+    if (base < 2 || base == 10)
+        return format_decimal(end, n);
+
+    if (!(base & (base - 1))) {
+        unsigned char shift = 0;
+        unsigned long mask = base - 1;
+
+        while ((1U << shift) < base)
+            shift++;
+        do {
+            char c = n & mask;
+            *--end = c < 10 ? c + '0' : c + 'A' - 10;
+            n >>= shift;
+        } while (n);
+        return end;
+    }
+
+    do {
+        unsigned long m = n;
+        n /= base;
+        char c = m - base * n;
+        *--end = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return end;
+}
+
+/*
+ * Writes "nan", "inf" or "ovf", like Arduino, for the numbers whose integer
+ * part does not fit 32 bits. Returns 0 for the other numbers.
+ */
+static int format_special(char *buf, double number)
+{
+    const char *str;
+
+    if (isnan(number))
+        str = "nan";
+    else if (isinf(number))
+        str = "inf";
+    else if (number > FORMAT_DOUBLE_MAX || number < -FORMAT_DOUBLE_MAX)
+        str = "ovf";
+    else
+        return 0;
+    buf[0] = str[0];
+    buf[1] = str[1];
+    buf[2] = str[2];
+    return 3;
+}
+
+/*
+ * Writes the integer part and the 'digits' decimals 'frac' of a number
+ * already split and rounded.
+ */
+static int format_fixed(char *buf, char *p, unsigned long int_part,
+                        unsigned long frac, unsigned char digits)
+{
+    char tmp[FORMAT_ULONG_SIZE];
+    char *end = &tmp[sizeof(tmp)];
+    char *str = format_decimal(end, int_part);
+
+    while (str < end)
+        *p++ = *str++;
+    if (digits) {
+        *p++ = '.';
+        str = format_decimal(p + digits, frac);
+        while (str > p)
+            *--str = '0';
+        p += digits;
+    }
+    return p - buf;
+}
+
+int format_double(char *buf, double number, unsigned char digits)
+{
+    char *p = buf;
+    unsigned long int_part;
+    unsigned long frac = 0;
+    double remainder;
+
+    int len = format_special(buf, number);
+
+    if (len)
+        return len;
+    if (digits > FORMAT_MAX_DECIMALS)
+        digits = FORMAT_MAX_DECIMALS;
+    if (number < 0.0) {
+        *p++ = '-';
+        number = -number;
+    }
+
+    /* round correctly so that 1.999 with 2 decimals prints as "2.00" */
+    int_part = (unsigned long)number;
+    remainder = (number - (double)int_part) * (double)format_pow10[digits] + 0.5;
+    frac = (unsigned long)remainder;
+    if (frac >= format_pow10[digits]) {
+        frac -= format_pow10[digits];
+        int_part++;
+    }
+    /* format_fixed() writes 'digits' digits of 'frac' at most */
+    if (frac >= format_pow10[digits])
+        frac = format_pow10[digits] - 1;
+    return format_fixed(buf, p, int_part, frac, digits);
+}
+
+int format_float(char *buf, float number, unsigned char digits)
+{
+    char *p = buf;
+    unsigned long int_part;
+    unsigned long frac = 0;
+    float remainder;
+
+    int len = format_special(buf, number);
+
+    if (len)
+        return len;
+    if (digits > FORMAT_MAX_DECIMALS)
+        digits = FORMAT_MAX_DECIMALS;
+    if (number < 0.0f) {
+        *p++ = '-';
+        number = -number;
+    }
+
+    int_part = (unsigned long)number;
+    remainder = (number - (float)int_part) * (float)format_pow10[digits] + 0.5f;
+    frac = (unsigned long)remainder;
+    if (frac >= format_pow10[digits]) {
+        frac -= format_pow10[digits];
+        int_part++;
+    }
+    /* format_fixed() writes 'digits' digits of 'frac' at most */
+    if (frac >= format_pow10[digits])
+        frac = format_pow10[digits] - 1;
+    return format_fixed(buf, p, int_part, frac, digits);
+}
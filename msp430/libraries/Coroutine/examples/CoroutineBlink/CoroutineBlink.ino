@@ -0,0 +1,70 @@
+/*
+  CoroutineBlink
+  Blinks the two LEDs of the LaunchPad at different rates, and counts the
+  presses of PUSH2, with three coroutines driven from loop().
+*/
+
+#include <Coroutine.h>
+
+class Blink : public Coroutine
+{
+public:
+  int led;
+  unsigned long period;
+
+  Blink(int led, unsigned long period) : led(led), period(period) {}
+
+  char run()
+  {
+    CO_BEGIN();
+    pinMode(led, OUTPUT);
+    for (;;)
+    {
+      digitalWrite(led, HIGH);
+      CO_DELAY(period);
+      digitalWrite(led, LOW);
+      CO_DELAY(period);
+    }
+    CO_END();
+  }
+};
+
+class Button : public Coroutine
+{
+public:
+  int presses;
+
+  char run()
+  {
+    CO_BEGIN();
+    pinMode(PUSH2, INPUT_PULLUP);
+    for (presses = 1; ; presses++)
+    {
+      CO_WAIT_UNTIL(digitalRead(PUSH2) == LOW);
+      Serial.print("presses: ");
+      Serial.println(presses);
+      CO_DELAY(20);   /* debounce */
+      CO_WAIT_UNTIL(digitalRead(PUSH2) == HIGH);
+      CO_DELAY(20);
+    }
+    CO_END();
+  }
+};
+
+Blink red(RED_LED, 500);
+Blink green(GREEN_LED, 150);
+Button button;
+CoroutineScheduler coroutines;
+
+void setup()
+{
+  Serial.begin(9600);
+  coroutines.add(red);
+  coroutines.add(green);
+  coroutines.add(button);
+}
+
+void loop()
+{
+  coroutines.runOnce();
+}